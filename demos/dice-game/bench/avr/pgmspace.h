@@ -0,0 +1,9 @@
+/* Host stand-in for <avr/pgmspace.h>, so dice.c builds for bench/ */
+#ifndef PGMSPACE_HOST_H
+#define PGMSPACE_HOST_H
+
+#define PROGMEM
+#define pgm_read_byte(p)    (*(const uint8_t *)(p))
+#define pgm_read_word(p)    (*(const uint16_t *)(p))
+
+#endif
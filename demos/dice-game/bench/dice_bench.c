@@ -0,0 +1,111 @@
+/* Host benchmark for roll_dice_batch(): 1M rolls against the original
+   two roll_dice() calls per roll, plus a check of the batch path against
+   eight lfsr_next() steps per byte.
+
+   gcc -O2 -Ibench -Iinclude bench/dice_bench.c src/dice.c -o dice_bench
+
+   (run from demos/dice-game) */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "dice.h"
+
+#define N_ROLLS 1000000L
+#define CHUNK   60000           // keeps each tally within uint16_t
+
+void lfsr_next(Dice* d);
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// roll_dice_batch() spelled out one bit at a time
+static void ref_batch(Dice* d, uint16_t num_rolls, uint16_t* results)
+{
+    while (num_rolls)
+    {
+        uint8_t b = d->LFSR & 0xFF;
+        for (uint8_t k = 0; k < 8; k++) lfsr_next(d);
+
+        if (b < 252)
+        {
+            uint8_t q = b % 36;
+            results[q / 6 + q % 6]++;
+            num_rolls--;
+        }
+    }
+}
+
+static int check(void)
+{
+    Dice a, b;
+    uint16_t ra[11], rb[11];
+
+    init_dice(&a, 0xCAB202);
+    init_dice(&b, 0xCAB202);
+    for (uint16_t k = 0; k < 1000; k++)
+    {
+        memset(ra, 0, sizeof ra);
+        memset(rb, 0, sizeof rb);
+        roll_dice_batch(&a, 100, ra);
+        ref_batch(&b, 100, rb);
+        if (a.LFSR != b.LFSR || memcmp(ra, rb, sizeof ra))
+        {
+            printf("batch and bit-by-bit paths differ at block %u\n", k);
+            return 1;
+        }
+    }
+    printf("batch matches bit-by-bit stepping over 100000 rolls\n");
+    return 0;
+}
+
+int main(void)
+{
+    static const uint8_t ways[11] = {1, 2, 3, 4, 5, 6, 5, 4, 3, 2, 1};
+    unsigned long old_n[11] = {0}, batch_n[11] = {0};
+    uint16_t res[11];
+    Dice d1, d2, e;
+
+    if (check()) return 1;
+
+    init_dice(&d1, 0xCAB202);
+    init_dice(&d2, 0x345678);
+    double t0 = now();
+    for (long i = 0; i < N_ROLLS; i++)
+    {
+        uint8_t score = roll_dice(&d1) + roll_dice(&d2);
+        old_n[score - 2]++;
+    }
+    double t1 = now();
+
+    init_dice(&e, 0xCAB202);
+    for (long done = 0; done < N_ROLLS; )
+    {
+        uint16_t n = (N_ROLLS - done > CHUNK) ? CHUNK : (uint16_t)(N_ROLLS - done);
+        memset(res, 0, sizeof res);
+        roll_dice_batch(&e, n, res);
+        for (uint8_t k = 0; k < 11; k++) batch_n[k] += res[k];
+        done += n;
+    }
+    double t2 = now();
+
+    printf("roll_dice x2 %6.1f ms\nbatch        %6.1f ms\nspeedup      %6.1fx\n\n",
+           (t1 - t0) * 1e3, (t2 - t1) * 1e3, (t1 - t0) / (t2 - t1));
+
+    double chi_old = 0, chi_batch = 0;
+    printf("score  expect     old   batch\n");
+    for (uint8_t k = 0; k < 11; k++)
+    {
+        double expect = N_ROLLS * ways[k] / 36.0;
+        chi_old += (old_n[k] - expect) * (old_n[k] - expect) / expect;
+        chi_batch += (batch_n[k] - expect) * (batch_n[k] - expect) / expect;
+        printf("%5u %7.0f %7lu %7lu\n", k + 2, expect, old_n[k], batch_n[k]);
+    }
+    printf("chi^2 (10 dof): old %.1f, batch %.1f\n", chi_old, chi_batch);
+    return 0;
+}
@@ -10,4 +10,8 @@ typedef struct dice {
 void init_dice(Dice *d, uint32_t lfsr);
 uint8_t roll_dice(Dice *d);
 
+/* Rolls both dice num_rolls times from d alone and adds each score to
+   results[score - 2] (11 entries). Advances the LFSR a byte per step. */
+void roll_dice_batch(Dice *d, uint16_t num_rolls, uint16_t *results);
+
 #endif
\ No newline at end of file
@@ -1,11 +1,14 @@
 #include <stdint.h>
 #include <stdio.h>
+#include <avr/pgmspace.h>
 
 #include "dice.h"
 
 //uint32_t LFSR = 0xCAB202;
 
-const uint32_t MASK = 0xE10000;
+#define LFSR_MASK 0xE10000UL
+
+const uint32_t MASK = LFSR_MASK;
 
 void init_dice(Dice* d, uint32_t lfsr) 
 {
@@ -34,4 +37,50 @@ uint8_t roll_dice(Dice* d)
     } while (result > 5); // Rejection sampling
 
     return result + 1;
-}
\ No newline at end of file
+}
+
+// Eight LFSR steps at once. MASK only has bits 16..23, so feedback from the
+// low byte lands on bits 9 and up and never reaches bits 0..7 within the
+// eight steps: s = (s >> 8) ^ T[s & 0xFF], where bit i of the byte adds
+// MASK >> (7 - i). T only spans bits 9..23 and is stored >> 8.
+#define LFSR_T(b)   ((((b) & 0x01) ? LFSR_MASK >> 7 : 0) ^ (((b) & 0x02) ? LFSR_MASK >> 6 : 0) ^ \
+                     (((b) & 0x04) ? LFSR_MASK >> 5 : 0) ^ (((b) & 0x08) ? LFSR_MASK >> 4 : 0) ^ \
+                     (((b) & 0x10) ? LFSR_MASK >> 3 : 0) ^ (((b) & 0x20) ? LFSR_MASK >> 2 : 0) ^ \
+                     (((b) & 0x40) ? LFSR_MASK >> 1 : 0) ^ (((b) & 0x80) ? LFSR_MASK : 0))
+#define T1(b)       (uint16_t)(LFSR_T(b) >> 8)
+#define T4(b)       T1(b), T1((b) + 1), T1((b) + 2), T1((b) + 3)
+#define T16(b)      T4(b), T4((b) + 4), T4((b) + 8), T4((b) + 12)
+#define T64(b)      T16(b), T16((b) + 16), T16((b) + 32), T16((b) + 48)
+
+static const uint16_t lfsr_step8[256] PROGMEM = { T64(0), T64(64), T64(128), T64(192) };
+
+// Score - 2 of the dice pair (q / 6 + 1, q % 6 + 1) for q = 0..35
+static const uint8_t pair_score[36] PROGMEM = {
+    0, 1, 2, 3, 4,  5,
+    1, 2, 3, 4, 5,  6,
+    2, 3, 4, 5, 6,  7,
+    3, 4, 5, 6, 7,  8,
+    4, 5, 6, 7, 8,  9,
+    5, 6, 7, 8, 9, 10
+};
+
+void roll_dice_batch(Dice* d, uint16_t num_rolls, uint16_t* results)
+{
+    uint32_t lfsr = d->LFSR;
+
+    while (num_rolls)
+    {
+        // The byte shifted out is eight fresh output bits; 252 = 7 * 36,
+        // so bytes below that map evenly onto the 36 pairs
+        uint8_t b = lfsr & 0xFF;
+        lfsr = (lfsr >> 8) ^ ((uint32_t)pgm_read_word(&lfsr_step8[b]) << 8);
+
+        if (b < 252)
+        {
+            results[pgm_read_byte(&pair_score[b % 36])]++;
+            num_rolls--;
+        }
+    }
+
+    d->LFSR = lfsr;
+}//roll_dice_batch
\ No newline at end of file
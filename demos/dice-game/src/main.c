@@ -66,15 +66,7 @@ uint16_t calc_decimal()
 }//calc_decimal
 
 void roll_n_times(uint16_t num_rolls) {
-    for (uint16_t n=0; n < num_rolls; n++)
-    {
-        result_d1 = roll_dice (&d1);
-        result_d2 = roll_dice (&d2);          
-
-        uint8_t score = result_d1 + result_d2; 
-        dice_results[score - 2]++;
-    }//for
-
+    roll_dice_batch (&d1, num_rolls, dice_results);
 }//roll_n_times
 
 int main (void) {  
@@ -0,0 +1,659 @@
+/* Virtual-time peripheral simulator behind hal_host.h.
+   Time only advances when the firmware calls into the HAL, so the game runs
+   as fast as the host allows while all timing stays in CLK_PER cycles. */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "hal.h"
+#include "sim.h"
+
+#undef main
+
+// Cost model in CLK_PER cycles
+#define HAL_CALL_CYCLES   4       // a register access plus call overhead
+#define ISR_CYCLES        40      // vector, prologue/epilogue, reti
+#define LOOP_CYCLES       150     // one pass of the main loop outside the HAL
+#define SPI_BYTE_CYCLES   32      // 8 bits at CLK_PER/4
+#define EEPROM_WRITE_CYCLES (F_CPU * 4 / 1000)   // ~4 ms erase + write
+
+#define NEVER UINT64_MAX
+
+// Weak defaults so every vector exists even if the firmware leaves it out
+__attribute__((weak)) void PORTA_PORT_vect(void) {}
+__attribute__((weak)) void TCB0_INT_vect(void) {}
+__attribute__((weak)) void TCB1_INT_vect(void) {}
+__attribute__((weak)) void SPI0_INT_vect(void) {}
+__attribute__((weak)) void USART0_RXC_vect(void) {}
+__attribute__((weak)) void USART0_DRE_vect(void) {}
+__attribute__((weak)) void CCL_CCL_vect(void) {}
+
+typedef struct {
+    uint8_t enabled;
+    uint8_t flag;
+    uint8_t div;                  // CLK_PER cycles per count
+    uint32_t period;              // in CLK_PER cycles
+    uint64_t next;
+    uint64_t raised;              // when flag was last set
+} sim_tcb_t;
+
+#define RX_QUEUE_MAX 4096
+
+// Driver callbacks scheduled with sim_at(), kept as a binary min-heap
+typedef struct {
+    uint64_t t;
+    uint64_t seq;                 // FIFO order for equal times
+    sim_callback_t fn;
+    intptr_t arg;
+} sim_timer_t;
+
+static struct {
+    uint64_t now;
+    uint64_t end;
+    uint8_t irq_on;
+    uint8_t in_isr;                 // 0, or 1 + the level of the running ISR
+    int8_t lvl1;                    // vector index at level 1, -1 for none
+    uint8_t rr, rr_next;            // level 0 round robin, next in line
+
+    sim_tcb_t tcb[2];
+
+    uint8_t spi_busy, spi_if, spi_ie, spi_shift;
+    uint64_t spi_done;
+    uint8_t disp_l, disp_r;
+
+    uint16_t buz_per, buz_cmp;
+    double buz_hz;
+
+    uint8_t pot;
+    uint8_t pins;
+    uint8_t pin_ie, pin_if;         // PORTA falling-edge interrupts
+    uint8_t filt_on, filt_if;       // CCL button filters, see hal_buttons_filter_init()
+    uint8_t filt_sync[2], filt_last, filt_out;
+    uint64_t filt_next;
+
+    uint16_t baud;
+    uint8_t clk2x, rxcie, dreie, txc;
+    uint8_t tx_shifting, tx_shift, tx_full, tx_data;
+    uint64_t tx_done;
+    uint8_t rx_full, rx_data;
+    uint32_t rx_overruns;
+    struct { uint64_t t; uint8_t b; } rx_queue[RX_QUEUE_MAX];
+    uint32_t rx_head, rx_count;
+    uint64_t rx_last;               // arrival of the last byte delivered
+    char tx_line[128];
+    uint8_t tx_line_len;
+    uint64_t tx_line_t;
+
+    uint8_t ee[HAL_EEPROM_SIZE];
+    uint8_t ee_buf[HAL_EEPROM_PAGE];
+    uint32_t ee_buf_valid;
+    uint8_t ee_page;
+    uint64_t ee_busy_until;
+
+    sim_timer_t *timers;
+    uint32_t timer_count, timer_cap;
+    uint64_t timer_seq;
+
+    uint64_t wdt_period, wdt_due;   // 0 while the watchdog is off
+    uint32_t wdt_timeouts;
+
+    uint64_t isr_count[7];
+    uint64_t isr_lat_max[7];        // flag set to vector entry, TCBs and RXC only
+    FILE *trace;
+    sim_observer_t observer;
+} sim = {
+    .irq_on = 0,
+    .lvl1 = -1,
+    .pins = 0xFF,
+    .disp_l = 0x7F,
+    .disp_r = 0x7F,
+    .end = NEVER,
+};
+
+// ---- tracing ---------------------------------------------------------- //
+
+double sim_ms(void) {
+    return (double)sim.now * 1000.0 / (double)F_CPU;
+}
+
+static void sim_trace(uint64_t t, const char *fmt, ...) {
+    if (!sim.trace) return;
+    va_list ap;
+    va_start(ap, fmt);
+    fprintf(sim.trace, "%10.3f ", (double)t * 1000.0 / (double)F_CPU);
+    vfprintf(sim.trace, fmt, ap);
+    fputc('\n', sim.trace);
+    va_end(ap);
+}
+
+static void sim_tx_flush(void) {
+    if (!sim.tx_line_len) return;
+    sim.tx_line[sim.tx_line_len] = '\0';
+    sim_trace(sim.tx_line_t, "UART %s", sim.tx_line);
+    sim.tx_line_len = 0;
+}
+
+static void sim_tx_byte_out(uint8_t b) {
+    if (sim.observer.uart_tx) sim.observer.uart_tx(sim.now, b);
+    if (!sim.tx_line_len) sim.tx_line_t = sim.now;
+    if (b >= 0x20 && b < 0x7F) {
+        sim.tx_line[sim.tx_line_len++] = (char)b;
+    } else if (b != '\n') {
+        sim.tx_line_len += (uint8_t)snprintf(&sim.tx_line[sim.tx_line_len], 5, "\\x%02X", b);
+    }
+    if (b == '\n' || sim.tx_line_len > sizeof(sim.tx_line) - 6) sim_tx_flush();
+}
+
+// ---- event engine ----------------------------------------------------- //
+
+static uint32_t sim_uart_frame_cycles(void) {
+    // cycles per bit = S * BAUD / 64, 10 bits per 8N1 frame
+    return (uint32_t)sim.baud * (sim.clk2x ? 8u : 16u) * 10u / 64u;
+}
+
+// Arrival of the next queued byte: no earlier than asked for, and one frame
+// at the current baud rate after the byte before (9600 before uart_init)
+static uint64_t sim_rx_due(void) {
+    uint64_t t = sim.rx_queue[sim.rx_head].t;
+    uint64_t next = sim.rx_last + (sim.baud ? sim_uart_frame_cycles() : F_CPU / 960);
+    return (sim.rx_last && next > t) ? next : t;
+}
+
+static uint64_t sim_next_event(void) {
+    uint64_t t = NEVER;
+    for (int n = 0; n < 2; n++) {
+        if (sim.tcb[n].enabled && sim.tcb[n].next < t) t = sim.tcb[n].next;
+    }
+    if (sim.spi_busy && sim.spi_done < t) t = sim.spi_done;
+    if (sim.tx_shifting && sim.tx_done < t) t = sim.tx_done;
+    if (sim.rx_count && sim_rx_due() < t) t = sim_rx_due();
+    if (sim.filt_on && sim.filt_next < t) t = sim.filt_next;
+    if (sim.timer_count && sim.timers[0].t < t) t = sim.timers[0].t;
+    if (sim.wdt_period && sim.wdt_due < t) t = sim.wdt_due;
+    if (sim.end < t) t = sim.end;
+    return t;
+}
+
+static int sim_timer_before(const sim_timer_t *a, const sim_timer_t *b) {
+    return a->t < b->t || (a->t == b->t && a->seq < b->seq);
+}
+
+static sim_timer_t sim_timer_pop(void) {
+    sim_timer_t top = sim.timers[0];
+    sim_timer_t last = sim.timers[--sim.timer_count];
+    uint32_t i = 0;
+    for (;;) {
+        uint32_t c = 2 * i + 1;
+        if (c >= sim.timer_count) break;
+        if (c + 1 < sim.timer_count && sim_timer_before(&sim.timers[c + 1], &sim.timers[c])) c++;
+        if (!sim_timer_before(&sim.timers[c], &last)) break;
+        sim.timers[i] = sim.timers[c];
+        i = c;
+    }
+    if (sim.timer_count) sim.timers[i] = last;
+    return top;
+}
+
+static void sim_finish(void) {
+    sim_tx_flush();
+    if (sim.observer.finish) sim.observer.finish();
+    exit(0);
+}
+
+// One 256 Hz filter clock: two synchroniser stages, then the output only
+// takes a value the synchronised input has held for two clocks
+static void sim_filter_clock(void) {
+    uint8_t in = sim.filt_sync[1];
+    sim.filt_sync[1] = sim.filt_sync[0];
+    sim.filt_sync[0] = sim.pins & 0xF0;
+    uint8_t steady = (uint8_t)~(in ^ sim.filt_last) & 0xF0;
+    uint8_t out = (sim.filt_out & ~steady) | (in & steady);
+    sim.filt_if |= out ^ sim.filt_out;
+    sim.filt_out = out;
+    sim.filt_last = in;
+}
+
+static void sim_handle_events(void) {
+    for (int n = 0; n < 2; n++) {
+        sim_tcb_t *tcb = &sim.tcb[n];
+        while (tcb->enabled && tcb->next <= sim.now) {
+            if (!tcb->flag) tcb->raised = tcb->next;
+            tcb->flag = 1;
+            tcb->next += tcb->period;
+        }
+    }
+    if (sim.spi_busy && sim.spi_done <= sim.now) {
+        sim.spi_busy = 0;
+        sim.spi_if = 1;
+    }
+    while (sim.tx_shifting && sim.tx_done <= sim.now) {
+        uint64_t t = sim.tx_done;
+        sim_tx_byte_out(sim.tx_shift);
+        if (sim.tx_full) {
+            sim.tx_shift = sim.tx_data;
+            sim.tx_full = 0;
+            sim.tx_done = t + sim_uart_frame_cycles();
+        } else {
+            sim.tx_shifting = 0;
+            sim.txc = 1;
+        }
+    }
+    while (sim.filt_on && sim.filt_next <= sim.now) {
+        sim_filter_clock();
+        sim.filt_next += F_CPU / HAL_PB_FILTER_HZ;
+    }
+    while (sim.rx_count && sim_rx_due() <= sim.now) {
+        sim.rx_last = sim_rx_due();
+        if (sim.rx_full) {
+            sim.rx_overruns++;
+        } else {
+            sim.rx_data = sim.rx_queue[sim.rx_head].b;
+            sim.rx_full = 1;
+            if (sim.observer.uart_rx) sim.observer.uart_rx(sim.rx_last, sim.rx_data);
+        }
+        sim.rx_head = (sim.rx_head + 1) % RX_QUEUE_MAX;
+        sim.rx_count--;
+    }
+    while (sim.wdt_period && sim.wdt_due <= sim.now) {
+        sim.wdt_timeouts++;
+        sim_trace(sim.wdt_due, "WDT timeout");
+        sim.wdt_due += sim.wdt_period;
+    }
+    while (sim.timer_count && sim.timers[0].t <= sim.now) {
+        sim_timer_t tm = sim_timer_pop();
+        tm.fn(tm.arg);
+    }
+    if (sim.now >= sim.end) sim_finish();
+}
+
+// Vector indices (as in isr_count[]) in fixed priority order
+static const uint8_t isr_order[7] = { 5, 0, 1, 2, 3, 4, 6 };
+
+// Vectors with their flag and enable set, one bit per isr_count[] index
+static uint8_t sim_isr_pending(void) {
+    return (uint8_t)(sim.tcb[0].flag
+                     | sim.tcb[1].flag << 1
+                     | (sim.spi_if && sim.spi_ie) << 2
+                     | (sim.rx_full && sim.rxcie) << 3
+                     | (!sim.tx_full && sim.dreie) << 4
+                     | (sim.pin_if != 0) << 5
+                     | (sim.filt_if != 0) << 6);
+}
+
+static void sim_run_isr(int idx) {
+    static void (*const vectors[7])(void) = {
+        TCB0_INT_vect, TCB1_INT_vect, SPI0_INT_vect, USART0_RXC_vect,
+        USART0_DRE_vect, PORTA_PORT_vect, CCL_CCL_vect
+    };
+    uint64_t raised = idx < 2 ? sim.tcb[idx].raised : idx == 3 ? sim.rx_last : sim.now;
+    if (sim.now - raised > sim.isr_lat_max[idx]) sim.isr_lat_max[idx] = sim.now - raised;
+    uint8_t was = sim.in_isr;
+    sim.in_isr = (idx == sim.lvl1) ? 2 : 1;
+    sim.isr_count[idx]++;
+    hal_host_advance(ISR_CYCLES);
+    vectors[idx]();
+    sim.in_isr = was;
+}
+
+// Runs pending interrupts like CPUINT: the level 1 vector may interrupt a
+// level 0 ISR; level 0 runs one at a time in priority order, or round
+// robin after the last one served (see hal_irq_priority_init())
+static void sim_dispatch(void) {
+    while (sim.irq_on) {
+        uint8_t pending = sim_isr_pending();
+        if (!pending) break;            // the common case, once per HAL call
+        if (sim.lvl1 >= 0 && sim.in_isr < 2 && (pending & (1u << sim.lvl1))) {
+            sim_run_isr(sim.lvl1);
+            continue;
+        }
+        if (sim.in_isr) break;
+        if (sim.lvl1 >= 0) pending &= (uint8_t)~(1u << sim.lvl1);
+        if (!pending) break;
+
+        int found = -1;
+        for (int k = 0; k < 7 && found < 0; k++) {
+            int pos = sim.rr ? (sim.rr_next + k) % 7 : k;
+            if (pending & (1u << isr_order[pos])) found = pos;
+        }
+        if (sim.rr) sim.rr_next = (uint8_t)((found + 1) % 7);
+        sim_run_isr(isr_order[found]);
+    }
+}
+
+void hal_host_advance(uint32_t cycles) {
+    uint64_t target = sim.now + cycles;
+    for (;;) {
+        uint64_t t = sim_next_event();
+        if (t > target) break;
+        if (t > sim.now) sim.now = t;
+        uint64_t before = sim.now;
+        sim_handle_events();
+        sim_dispatch();
+        target += sim.now - before;     // ISRs preempt the caller's cycles
+    }
+    sim.now = target;
+    sim_dispatch();
+}
+
+uint64_t hal_host_cycles(void) {
+    return sim.now;
+}
+
+static void hal_call(void) {
+    hal_host_advance(HAL_CALL_CYCLES);
+}
+
+// ---- interrupts -------------------------------------------------------- //
+
+void hal_host_irq(uint8_t enable) {
+    sim.irq_on = enable;
+    if (enable) sim_dispatch();
+}
+
+uint8_t hal_host_irq_save(void) {
+    uint8_t was = sim.irq_on;
+    sim.irq_on = 0;
+    return was;
+}
+
+void hal_host_irq_restore(uint8_t *state) {
+    sim.irq_on = *state;
+    hal_call();
+}
+
+// TCB1 (display and debounce tick) at level 1, round robin at level 0
+void hal_irq_priority_init(void) {
+    sim.lvl1 = 1;
+    sim.rr = 1;
+    hal_call();
+}
+
+uint8_t hal_reset_flags(void) {
+    hal_call();
+    return HAL_RESET_POWER_ON;
+}
+
+// Same period rounding as the AVR, on the 1.024 kHz watchdog clock
+void hal_wdt_enable(uint16_t ms) {
+    uint32_t clocks = 8;
+    while (clocks < ms && clocks < 8192) clocks <<= 1;
+    sim.wdt_period = (uint64_t)clocks * F_CPU / 1024;
+    sim.wdt_due = sim.now + sim.wdt_period;
+    hal_call();
+}
+
+void hal_wdt_reset(void) {
+    if (sim.wdt_period) sim.wdt_due = sim.now + sim.wdt_period;
+    hal_call();
+}
+
+// ---- HAL ---------------------------------------------------------------- //
+
+void hal_idle(void) {
+    hal_host_advance(LOOP_CYCLES);
+}
+
+void hal_clock_init(void) {
+}
+
+void hal_tcb_init_periodic(uint8_t n, uint16_t ccmp, uint8_t div2) {
+    sim.tcb[n].div = div2 ? 2 : 1;
+    sim.tcb[n].period = ((uint32_t)ccmp + 1) * sim.tcb[n].div;
+    sim.tcb[n].next = sim.now + sim.tcb[n].period;
+    sim.tcb[n].flag = 0;
+    sim.tcb[n].enabled = 1;
+}
+
+// Takes effect on the period in progress, as a CCMP write does
+void hal_tcb_set_top(uint8_t n, uint16_t ccmp) {
+    sim_tcb_t *tcb = &sim.tcb[n];
+    uint64_t start = tcb->next - tcb->period;
+    tcb->period = ((uint32_t)ccmp + 1) * tcb->div;
+    tcb->next = start + tcb->period;
+    hal_call();
+}
+
+void hal_tcb_ack(uint8_t n) {
+    sim.tcb[n].flag = 0;
+    hal_call();
+}
+
+uint16_t hal_tcb_count(uint8_t n) {
+    hal_call();
+    return (uint16_t)((sim.now + sim.tcb[n].period - sim.tcb[n].next) % sim.tcb[n].period / sim.tcb[n].div);
+}
+
+uint8_t hal_tcb_pending(uint8_t n) {
+    return sim.tcb[n].flag;
+}
+
+void hal_buttons_init(void) {}
+
+void hal_buttons_irq_init(void) {
+    sim.pin_ie = 0xF0;
+    hal_call();
+}
+
+uint8_t hal_buttons_irq_ack(void) {
+    uint8_t f = sim.pin_if;
+    sim.pin_if = 0;
+    hal_call();
+    return f;
+}
+
+void hal_buttons_filter_init(void) {
+    sim.filt_sync[0] = sim.filt_sync[1] = sim.filt_last = sim.filt_out = sim.pins & 0xF0;
+    sim.filt_if = 0;
+    sim.filt_next = sim.now + F_CPU / HAL_PB_FILTER_HZ;
+    sim.filt_on = 1;
+    hal_call();
+}
+
+uint8_t hal_buttons_filter_ack(void) {
+    uint8_t f = sim.filt_if;
+    sim.filt_if = 0;
+    hal_call();
+    return f;
+}
+
+uint8_t hal_buttons_read(void) {
+    hal_call();
+    return sim.pins;
+}
+
+void hal_buzzer_init(void) {
+    sim.buz_per = 1;
+    sim.buz_cmp = 0;
+}
+
+static void sim_buzzer_update(void) {
+    // TCA0 at CLK_PER/BUZZER_TCA_DIV, single slope: f = BUZZER_CLK_HZ / (PER + 1)
+    double hz = sim.buz_cmp ? (double)F_CPU / BUZZER_TCA_DIV / ((double)sim.buz_per + 1.0) : 0.0;
+    if (hz != sim.buz_hz) {
+        sim.buz_hz = hz;
+        sim_trace(sim.now, "BUZ %.1f", hz);
+        if (sim.observer.buzzer) sim.observer.buzzer(sim.now, hz);
+    }
+}
+
+void hal_buzzer_set(uint16_t per, uint16_t cmp) {
+    sim.buz_per = per;
+    sim.buz_cmp = cmp;
+    sim_buzzer_update();
+    hal_call();
+}
+
+void hal_buzzer_mute(void) {
+    sim.buz_cmp = 0;
+    sim_buzzer_update();
+    hal_call();
+}
+
+void hal_display_init(void) {
+    sim.spi_ie = 1;
+}
+
+void hal_spi_write(uint8_t data) {
+    sim.spi_shift = data;
+    sim.spi_busy = 1;
+    sim.spi_done = sim.now + SPI_BYTE_CYCLES;
+    hal_call();
+}
+
+void hal_display_latch(void) {
+    // Bit 7 selects the left digit; segments are active low
+    uint8_t l = sim.disp_l, r = sim.disp_r;
+    if (sim.spi_shift & 0x80) l = sim.spi_shift & 0x7F;
+    else                      r = sim.spi_shift & 0x7F;
+    sim.spi_if = 0;
+    if (l != sim.disp_l || r != sim.disp_r) {
+        sim.disp_l = l;
+        sim.disp_r = r;
+        sim_trace(sim.now, "DISP %02X %02X", l, r);
+        if (sim.observer.display) sim.observer.display(sim.now, l, r);
+    }
+    hal_call();
+}
+
+void hal_adc_init_pot(void) {}
+
+uint8_t hal_adc_read8(void) {
+    hal_call();
+    return sim.pot;
+}
+
+void hal_uart_init(void) {
+    sim.rxcie = 1;
+}
+
+void hal_uart_set_baud(uint16_t baud, uint8_t clk2x) {
+    sim.baud = baud;
+    sim.clk2x = clk2x;
+    hal_call();
+}
+
+uint8_t hal_uart_rx_ready(void) {
+    hal_call();
+    return sim.rx_full;
+}
+
+uint8_t hal_uart_rx_byte(void) {
+    sim.rx_full = 0;
+    return sim.rx_data;
+}
+
+void hal_uart_tx_byte(uint8_t c) {
+    if (!sim.tx_shifting) {
+        sim.tx_shift = c;
+        sim.tx_shifting = 1;
+        sim.tx_done = sim.now + sim_uart_frame_cycles();
+    } else {
+        sim.tx_data = c;            // overwrites if the firmware ignored DREIF
+        sim.tx_full = 1;
+    }
+    hal_call();
+}
+
+void hal_uart_dre_irq(uint8_t enable) {
+    sim.dreie = enable;
+    hal_call();
+}
+
+void hal_uart_txc_clear(void) {
+    sim.txc = 0;
+    hal_call();
+}
+
+uint8_t hal_uart_txc(void) {
+    hal_call();
+    return sim.txc;
+}
+
+const volatile uint8_t *hal_eeprom_ptr(uint8_t addr) {
+    return &sim.ee[addr];
+}
+
+void hal_eeprom_buffer_write(uint8_t addr, uint8_t v) {
+    sim.ee_page = addr & (uint8_t)~(HAL_EEPROM_PAGE - 1);
+    sim.ee_buf[addr % HAL_EEPROM_PAGE] = v;
+    sim.ee_buf_valid |= 1UL << (addr % HAL_EEPROM_PAGE);
+}
+
+void hal_eeprom_page_erase_write(void) {
+    for (uint8_t k = 0; k < HAL_EEPROM_PAGE; k++) {
+        if (sim.ee_buf_valid & (1UL << k)) sim.ee[sim.ee_page + k] = sim.ee_buf[k];
+    }
+    sim.ee_buf_valid = 0;
+    sim.ee_busy_until = sim.now + EEPROM_WRITE_CYCLES;
+    if (sim.observer.eeprom) sim.observer.eeprom(sim.now, sim.ee);
+    hal_call();
+}
+
+uint8_t hal_eeprom_busy(void) {
+    hal_call();
+    return sim.now < sim.ee_busy_until;
+}
+
+// ---- simulator control (sim.h) ------------------------------------------ //
+
+void sim_set_trace(FILE *f)               { sim.trace = f; }
+void sim_set_observer(const sim_observer_t *o) { sim.observer = *o; }
+void sim_set_end_ms(double ms)            { sim.end = (uint64_t)(ms * F_CPU / 1000.0); }
+void sim_set_pot(uint8_t v)               { sim.pot = v; }
+void sim_set_pins(uint8_t pins) {
+    sim.pin_if |= sim.pins & (uint8_t)~pins & sim.pin_ie;
+    sim.pins = pins;
+}
+uint8_t sim_get_pins(void)                { return sim.pins; }
+uint8_t *sim_eeprom(void)                 { return sim.ee; }
+uint32_t sim_uart_bit_cycles(void)        { return sim_uart_frame_cycles() / 10u; }
+
+void sim_uart_inject(double t_ms, uint8_t b) {
+    if (sim.rx_count == RX_QUEUE_MAX) return;
+    uint64_t t = (uint64_t)(t_ms * F_CPU / 1000.0);
+    uint32_t tail = (sim.rx_head + sim.rx_count) % RX_QUEUE_MAX;
+    sim.rx_queue[tail].t = t;
+    sim.rx_queue[tail].b = b;
+    sim.rx_count++;
+}
+
+void sim_at(double t_ms, sim_callback_t fn, intptr_t arg) {
+    if (sim.timer_count == sim.timer_cap) {
+        sim.timer_cap = sim.timer_cap ? 2 * sim.timer_cap : 64;
+        sim.timers = realloc(sim.timers, sim.timer_cap * sizeof(sim_timer_t));
+        if (!sim.timers) abort();
+    }
+    sim_timer_t tm = { (uint64_t)(t_ms * F_CPU / 1000.0), sim.timer_seq++, fn, arg };
+    if (tm.t < sim.now) tm.t = sim.now;
+    uint32_t i = sim.timer_count++;
+    while (i && sim_timer_before(&tm, &sim.timers[(i - 1) / 2])) {
+        sim.timers[i] = sim.timers[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    sim.timers[i] = tm;
+}
+
+void sim_stop(void) {
+    sim.end = sim.now;
+}
+
+double sim_isr_latency_max_us(int idx) {
+    return (double)sim.isr_lat_max[idx] * 1e6 / (double)F_CPU;
+}
+
+void sim_print_stats(FILE *f, double wall_s) {
+    static const char *names[7] = { "TCB0_INT", "TCB1_INT", "SPI0_INT", "USART0_RXC", "USART0_DRE", "PORTA_PORT",
+                                    "CCL_CCL" };
+    double ms = sim_ms();
+    fprintf(f, "virtual %.3f ms in %.3f s wall (%.0fx real time)\n",
+            ms, wall_s, wall_s > 0 ? ms / 1000.0 / wall_s : 0.0);
+    for (int k = 0; k < 7; k++) {
+        fprintf(f, "  %-11s %llu", names[k], (unsigned long long)sim.isr_count[k]);
+        if (k < 2 || k == 3) fprintf(f, ", latency max %.1f us", sim_isr_latency_max_us(k));
+        fputc('\n', f);
+    }
+    if (sim.rx_overruns) fprintf(f, "  rx overruns %u\n", sim.rx_overruns);
+    if (sim.wdt_timeouts) fprintf(f, "  watchdog timeouts %u\n", sim.wdt_timeouts);
+}
@@ -0,0 +1,137 @@
+#ifndef HAL_HOST_H
+#define HAL_HOST_H
+
+/* Linux backend for hal.h.
+   Peripherals are simulated in virtual CPU cycles at F_CPU: TCB0/TCB1
+   periodic interrupts, the SPI display shift register and latch, TCA0
+   buzzer PWM, the ADC pot reading, USART0 (TX shifter, RX arrival) and the
+   EEPROM with its erase/write busy time. Every hal_* call charges a few
+   cycles and gives pending interrupts a chance to run, so busy-waits make
+   progress; hal_idle() charges one main-loop pass. Only the level 1
+   vector nests, as with CPUINT (see hal_irq_priority_init()). See
+   host/hal_host.c. */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "board_config.h"         // F_CPU and the derived timer settings
+
+// The firmware's main() becomes firmware_main(); hal_host.c owns main()
+#define main firmware_main
+int firmware_main(void);
+
+// ---- avr-libc stand-ins ---------------------------------------------- //
+
+#define PROGMEM
+#define PSTR(s)             (s)
+#define pgm_read_byte(p)    (*(const uint8_t *)(p))
+#define pgm_read_word(p)    (*(const uint16_t *)(p))
+#define pgm_read_dword(p)   (*(const uint32_t *)(p))
+#define pgm_read_ptr(p)     (*(void * const *)(p))
+#define strlen_P            strlen
+#define strncmp_P           strncmp
+
+#define ISR(vector)         void vector(void)
+
+// TLOG format strings (tlog.h) in an ordinary "tlog" section, the token
+// being the offset into it as on the AVR
+extern const char __start_tlog[];
+#define TLOG_TOKEN(s) __extension__({ \
+        static const char tlog_fmt_[] __attribute__((section("tlog"), used)) = (s); \
+        (uint16_t)(tlog_fmt_ - __start_tlog); })
+
+void hal_host_irq(uint8_t enable);
+uint8_t hal_host_irq_save(void);
+void hal_host_irq_restore(uint8_t *state);
+
+#define cli()               hal_host_irq(0)
+#define sei()               hal_host_irq(1)
+
+#define ATOMIC_RESTORESTATE 0
+#define ATOMIC_FORCEON      1
+#define ATOMIC_BLOCK(type) \
+    for (uint8_t hal_sreg_ __attribute__((cleanup(hal_host_irq_restore))) = hal_host_irq_save(), \
+         hal_once_ = 1; hal_once_; hal_once_ = 0)
+
+#define PIN0_bm 0x01
+#define PIN1_bm 0x02
+#define PIN2_bm 0x04
+#define PIN3_bm 0x08
+#define PIN4_bm 0x10
+#define PIN5_bm 0x20
+#define PIN6_bm 0x40
+#define PIN7_bm 0x80
+
+// Vectors the simulator can raise, highest priority first (ATtiny1626 order)
+void PORTA_PORT_vect(void);
+void TCB0_INT_vect(void);
+void TCB1_INT_vect(void);
+void SPI0_INT_vect(void);
+void USART0_RXC_vect(void);
+void USART0_DRE_vect(void);
+void CCL_CCL_vect(void);
+
+// ---- HAL -------------------------------------------------------------- //
+
+void hal_idle(void);
+
+void hal_clock_init(void);
+void hal_irq_priority_init(void);
+
+// The simulator only ever powers on, so HAL_NOINIT statics start zeroed
+#define HAL_RESET_POWER_ON  0x01
+#define HAL_RESET_WATCHDOG  0x08
+#define HAL_NOINIT
+uint8_t hal_reset_flags(void);
+
+// A watchdog timeout is traced and counted, but does not reset anything
+void hal_wdt_enable(uint16_t ms);
+void hal_wdt_reset(void);
+
+void hal_tcb_init_periodic(uint8_t n, uint16_t ccmp, uint8_t div2);
+void hal_tcb_set_top(uint8_t n, uint16_t ccmp);
+void hal_tcb_ack(uint8_t n);
+uint16_t hal_tcb_count(uint8_t n);
+uint8_t hal_tcb_pending(uint8_t n);
+
+void hal_buttons_init(void);
+uint8_t hal_buttons_read(void);
+void hal_buttons_irq_init(void);
+uint8_t hal_buttons_irq_ack(void);
+#define HAL_PB_FILTER_HZ 256
+void hal_buttons_filter_init(void);
+uint8_t hal_buttons_filter_ack(void);
+
+void hal_buzzer_init(void);
+void hal_buzzer_set(uint16_t per, uint16_t cmp);
+void hal_buzzer_mute(void);
+
+void hal_display_init(void);
+void hal_spi_write(uint8_t data);
+void hal_display_latch(void);
+
+void hal_adc_init_pot(void);
+uint8_t hal_adc_read8(void);
+
+void hal_uart_init(void);
+void hal_uart_set_baud(uint16_t baud, uint8_t clk2x);
+uint8_t hal_uart_rx_ready(void);
+uint8_t hal_uart_rx_byte(void);
+void hal_uart_tx_byte(uint8_t c);
+void hal_uart_dre_irq(uint8_t enable);
+void hal_uart_txc_clear(void);
+uint8_t hal_uart_txc(void);
+
+#define HAL_EEPROM_SIZE 256
+#define HAL_EEPROM_PAGE 32
+const volatile uint8_t *hal_eeprom_ptr(uint8_t addr);
+void hal_eeprom_buffer_write(uint8_t addr, uint8_t v);
+void hal_eeprom_page_erase_write(void);
+uint8_t hal_eeprom_busy(void);
+
+// ---- Simulator control (host code only) ------------------------------- //
+
+uint64_t hal_host_cycles(void);             // virtual time in CLK_PER cycles
+void hal_host_advance(uint32_t cycles);     // let virtual time pass
+
+#endif
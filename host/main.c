@@ -0,0 +1,125 @@
+/* Native Simon: runs the unmodified firmware against the simulated QUTy.
+
+   simon_host [-t ms] [-p pot] [-u text] [-s script] [-o trace] [-e eeprom.bin] [-w uart.bin] [-q]
+
+     -t  virtual run time in ms (default 10000, or 1 h with a script,
+         which normally ends itself)
+     -p  potentiometer position 0..255 (default 0, i.e. 250 ms delay)
+     -u  bytes sent to the UART, starting at 1 ms ("\n" allowed)
+     -s  replay script with stimulus and expectations (see replay.h);
+         exits with status 1 if any expectation fails
+     -o  write the trace to a file instead of stdout
+     -e  EEPROM image loaded at start and saved on exit
+     -w  every byte the UART sends, raw, as a serial capture would have
+         it (for tools/telemetry_decode.py and tools/tlog_decode.py)
+     -q  no trace, statistics only
+
+   The trace on stdout has one line per buzzer, display or UART line change,
+   stamped in virtual milliseconds. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hal_host.h"
+#include "sim.h"
+#include "replay.h"
+
+#undef main
+
+static struct timespec wall_start;
+static const char *eeprom_path = NULL;
+static const char *script_path = NULL;
+static FILE *uart_capture = NULL;
+
+static double wall_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - wall_start.tv_sec) + (double)(now.tv_nsec - wall_start.tv_nsec) * 1e-9;
+}
+
+static void on_uart_tx(uint64_t t, uint8_t b) {
+    if (uart_capture) fputc(b, uart_capture);
+    if (script_path) replay_on_uart(t, b);
+}
+
+static void on_finish(void) {
+    if (eeprom_path) {
+        FILE *f = fopen(eeprom_path, "wb");
+        if (f) {
+            fwrite(sim_eeprom(), 1, HAL_EEPROM_SIZE, f);
+            fclose(f);
+        }
+    }
+    if (uart_capture) fclose(uart_capture);
+    fflush(stdout);
+    sim_print_stats(stderr, wall_seconds());
+    if (script_path && replay_finish()) exit(1);
+}
+
+int main(int argc, char **argv) {
+    double run_ms = 0.0;
+    const char *uart_text = NULL;
+    int opt;
+
+    sim_set_trace(stdout);
+    while ((opt = getopt(argc, argv, "t:p:u:s:o:e:w:q")) != -1) {
+        switch (opt) {
+            case 't': run_ms = atof(optarg); break;
+            case 'p': sim_set_pot((uint8_t)atoi(optarg)); break;
+            case 'u': uart_text = optarg; break;
+            case 's': script_path = optarg; break;
+            case 'o': {
+                FILE *f = fopen(optarg, "w");
+                if (!f) { perror(optarg); return 2; }
+                sim_set_trace(f);
+                break;
+            }
+            case 'e': eeprom_path = optarg; break;
+            case 'w':
+                uart_capture = fopen(optarg, "wb");
+                if (!uart_capture) { perror(optarg); return 2; }
+                break;
+            case 'q': sim_set_trace(NULL); break;
+            default:
+                fprintf(stderr, "usage: %s [-t ms] [-p pot] [-u text] [-s script] [-o trace] [-e eeprom.bin] [-w uart.bin] [-q]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    memset(sim_eeprom(), 0xFF, HAL_EEPROM_SIZE);
+    if (eeprom_path) {
+        FILE *f = fopen(eeprom_path, "rb");
+        if (f) {
+            if (fread(sim_eeprom(), 1, HAL_EEPROM_SIZE, f) != HAL_EEPROM_SIZE) {
+                memset(sim_eeprom(), 0xFF, HAL_EEPROM_SIZE);
+            }
+            fclose(f);
+        }
+    }
+
+    if (uart_text) {
+        for (const char *p = uart_text; *p; p++) {
+            uint8_t b = (uint8_t)*p;
+            if (p[0] == '\\' && p[1] == 'n') { b = '\n'; p++; }
+            sim_uart_inject(1.0, b);
+        }
+    }
+
+    sim_observer_t obs = { .uart_tx = on_uart_tx, .finish = on_finish };
+    if (run_ms <= 0.0) run_ms = script_path ? 3600000.0 : 10000.0;
+    sim_set_end_ms(run_ms);
+    if (script_path) {
+        if (replay_load(script_path)) return 2;
+        obs.buzzer = replay_on_buzzer;
+        obs.display = replay_on_display;
+        obs.uart_rx = replay_on_uart_rx;
+    }
+    sim_set_observer(&obs);
+
+    clock_gettime(CLOCK_MONOTONIC, &wall_start);
+    firmware_main();
+    return 0;
+}
@@ -0,0 +1,463 @@
+/* Scripted replay harness, see replay.h */
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hal_host.h"
+#include "sim.h"
+#include "replay.h"
+
+#define MS_PER_CYCLE (1000.0 / (double)F_CPU)
+
+// ---- recorded outputs ---------------------------------------------------- //
+
+typedef struct { double t; double hz; } buz_ev_t;
+typedef struct { double t; uint8_t l, r; } disp_ev_t;
+typedef struct { double t; char text[64]; } uart_line_t;
+typedef struct { double t; int edge; } pb_edge_t;    // edge 0 = first step on
+
+#define GROW(arr, n, cap) do { \
+        if ((n) == (cap)) { \
+            (cap) = (cap) ? 2 * (cap) : 256; \
+            (arr) = realloc((arr), (cap) * sizeof(*(arr))); \
+            if (!(arr)) abort(); \
+        } \
+    } while (0)
+
+static buz_ev_t *buz;     static size_t buz_n, buz_cap;
+static disp_ev_t *disp;   static size_t disp_n, disp_cap;
+static uart_line_t *lines; static size_t lines_n, lines_cap;
+static pb_edge_t *pb_edges; static size_t pb_edges_n, pb_edges_cap;
+static char rx_line[64];
+static size_t rx_len;
+static double rx_t;
+
+// ---- expectations -------------------------------------------------------- //
+
+typedef enum { EXP_BUZZER, EXP_DISPLAY, EXP_UART, EXP_ROUNDS, EXP_SEQUENCE, EXP_DRIFT, EXP_LATENCY, EXP_RETUNE, EXP_CPU } exp_kind_t;
+
+typedef struct {
+    exp_kind_t kind;
+    int line;
+    double t;
+    double hz;
+    uint8_t l, r;
+    int n;
+    char text[64];
+} expect_t;
+
+static expect_t *expects; static size_t expects_n, expects_cap;
+
+// ---- autoplay ------------------------------------------------------------ //
+
+static const uint8_t step_left[4]  = { 0x3E, 0x6B, 0x7F, 0x7F };
+static const uint8_t step_right[4] = { 0x7F, 0x7F, 0x3E, 0x6B };
+#define SEGS_BLANK   0x7F
+#define SEGS_SUCCESS 0x00
+#define SEGS_FAIL    0x77
+
+static struct {
+    int active;
+    int use_uart;
+    int target;
+    int won;
+    int failed;
+    int round;
+    int seen;
+    int playing;              // 1 while Simon plays, 0 while we answer
+    int edges;                // buzzer edges seen in this playback
+    uint8_t steps[1024];
+    double on_t, on_ms;
+} ap;
+
+// ---- stimulus ------------------------------------------------------------ //
+
+static uint8_t button_mask(int button) {
+    return (uint8_t)(PIN4_bm << (button - 1));
+}
+
+static void cb_pin_low(intptr_t mask)  { sim_set_pins(sim_get_pins() & (uint8_t)~mask); }
+static void cb_pin_high(intptr_t mask) { sim_set_pins(sim_get_pins() | (uint8_t)mask); }
+static void cb_pot(intptr_t v)         { sim_set_pot((uint8_t)v); }
+static void cb_end(intptr_t unused)    { (void)unused; sim_stop(); }
+
+// Contact bounce: a few short opposite pulses before the level settles
+static const double bounce_ms[] = { 0.0, 0.3, 0.8, 1.5, 2.6 };
+
+static void schedule_edge(double t, uint8_t mask, int low, int bounce) {
+    if (!bounce) {
+        sim_at(t, low ? cb_pin_low : cb_pin_high, mask);
+        return;
+    }
+    for (size_t k = 0; k < sizeof(bounce_ms) / sizeof(bounce_ms[0]); k++) {
+        int level_low = (k % 2 == 0) ? low : !low;
+        sim_at(t + bounce_ms[k], level_low ? cb_pin_low : cb_pin_high, mask);
+    }
+}
+
+static void schedule_press(double t, int button, double hold, int bounce) {
+    uint8_t mask = button_mask(button);
+    schedule_edge(t, mask, 1, bounce);
+    schedule_edge(t + hold, mask, 0, bounce);
+}
+
+static void schedule_uart(double t, const char *text) {
+    for (const char *p = text; *p; p++) {
+        uint8_t b = (uint8_t)*p;
+        if (p[0] == '\\' && p[1] == 'n') { b = '\n'; p++; }
+        sim_uart_inject(t, b);
+    }
+}
+
+static void cb_autoplay_start(intptr_t arg) {
+    (void)arg;
+    ap.active = 1;
+    ap.round = 1;
+    ap.seen = 0;
+    ap.edges = 0;
+    ap.playing = 1;
+}
+
+// Answer the round that was just played back. The firmware only starts
+// listening one step-off period after the last step, and echoes each input
+// for at least half the playback delay.
+static void autoplay_answer(double t_blank) {
+    static const char keys[4] = { 'q', 'w', 'e', 'r' };
+    double t = t_blank + ap.on_ms + 15.0;
+    for (int k = 0; k < ap.round; k++) {
+        if (ap.use_uart) {
+            char s[2] = { keys[ap.steps[k]], '\0' };
+            schedule_uart(t, s);
+        } else {
+            schedule_press(t, ap.steps[k] + 1, 30.0, 0);
+        }
+        t += ap.on_ms + 60.0;
+    }
+}
+
+// ---- observer hooks ------------------------------------------------------ //
+
+// Octave keys that arrived while a tone sounded, for "expect retune"
+static struct {
+    double t;                 // arrival of the oldest unanswered key, < 0 for none
+    double hz;                // tone sounding when it arrived
+    double worst_ms;
+    int count;
+} rt = { -1.0, 0.0, 0.0, 0 };
+
+void replay_on_uart_rx(uint64_t t, uint8_t b) {
+    int octave_key = (b == ',' || b == 'k' || b == '.' || b == 'l');
+    double hz = buz_n ? buz[buz_n - 1].hz : 0.0;
+    if (octave_key && hz != 0.0 && rt.t < 0.0) {
+        rt.t = (double)t * MS_PER_CYCLE;
+        rt.hz = hz;
+    }
+}
+
+void replay_on_buzzer(uint64_t t, double hz) {
+    GROW(buz, buz_n, buz_cap);
+    buz[buz_n++] = (buz_ev_t){ (double)t * MS_PER_CYCLE, hz };
+
+    // A retune moves the tone by an octave; anything else (a new step, a
+    // key at the octave limit) drops the pending key
+    if (rt.t >= 0.0) {
+        double ratio = hz / rt.hz;
+        if (fabs(ratio - 2.0) < 0.02 || fabs(ratio - 0.5) < 0.005) {
+            double ms = (double)t * MS_PER_CYCLE - rt.t;
+            if (ms > rt.worst_ms) rt.worst_ms = ms;
+            rt.count++;
+        }
+        rt.t = -1.0;
+    }
+
+    // Playback tone edges, for "expect drift"
+    if (!ap.active || !ap.playing || (ap.edges == 0 && hz == 0.0)) return;
+    GROW(pb_edges, pb_edges_n, pb_edges_cap);
+    pb_edges[pb_edges_n++] = (pb_edge_t){ (double)t * MS_PER_CYCLE, ap.edges++ };
+}
+
+void replay_on_display(uint64_t t, uint8_t left, uint8_t right) {
+    double ms = (double)t * MS_PER_CYCLE;
+    GROW(disp, disp_n, disp_cap);
+    disp[disp_n++] = (disp_ev_t){ ms, left, right };
+
+    if (!ap.active) return;
+    if (left == SEGS_FAIL && right == SEGS_FAIL) {
+        ap.failed = 1;
+        ap.active = 0;
+        return;
+    }
+    if (ap.playing) {
+        for (int s = 0; s < 4; s++) {
+            if (left == step_left[s] && right == step_right[s] && ap.seen < (int)sizeof(ap.steps)) {
+                ap.steps[ap.seen++] = (uint8_t)s;
+                ap.on_t = ms;
+                return;
+            }
+        }
+        if (left == SEGS_BLANK && right == SEGS_BLANK && ap.seen == ap.round) {
+            ap.on_ms = ms - ap.on_t;
+            ap.playing = 0;
+            autoplay_answer(ms);
+        }
+    } else if (left == SEGS_SUCCESS && right == SEGS_SUCCESS) {
+        ap.won = ap.round;
+        if (ap.won >= ap.target) {
+            ap.active = 0;
+            sim_at(ms + 1.0, cb_end, 0);
+            return;
+        }
+        ap.round++;
+        ap.seen = 0;
+        ap.edges = 0;
+        ap.playing = 1;
+    }
+}
+
+void replay_on_uart(uint64_t t, uint8_t b) {
+    if (!rx_len) rx_t = (double)t * MS_PER_CYCLE;
+    if (b == '\n' || rx_len == sizeof(rx_line) - 1) {
+        while (rx_len && rx_line[rx_len - 1] == ' ') rx_len--;    // "Enter name: "
+        GROW(lines, lines_n, lines_cap);
+        lines[lines_n].t = rx_t;
+        memcpy(lines[lines_n].text, rx_line, rx_len);
+        lines[lines_n].text[rx_len] = '\0';
+        lines_n++;
+        rx_len = 0;
+        if (b == '\n') return;
+    }
+    rx_line[rx_len++] = (char)b;
+}
+
+// ---- script loading -------------------------------------------------------- //
+
+static int parse_error(const char *path, int line, const char *msg) {
+    fprintf(stderr, "%s:%d: %s\n", path, line, msg);
+    return -1;
+}
+
+static void copy_text(char *dst, const char *src, size_t cap) {
+    size_t n = 0;
+    while (*src && n < cap - 1) dst[n++] = *src++;
+    dst[n] = '\0';
+}
+
+int replay_load(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+
+    char buf[256];
+    double t_prev = 0.0;
+    int line = 0;
+    while (fgets(buf, sizeof(buf), f)) {
+        line++;
+        char *hash = strchr(buf, '#');
+        if (hash) *hash = '\0';
+        buf[strcspn(buf, "\r\n")] = '\0';
+
+        char *p = buf;
+        while (isspace((unsigned char)*p)) p++;
+        if (!*p) continue;
+
+        int relative = (*p == '+');
+        char *end;
+        double t = strtod(relative ? p + 1 : p, &end);
+        if (end == p) { fclose(f); return parse_error(path, line, "missing time"); }
+        if (relative) t += t_prev;
+        t_prev = t;
+
+        char cmd[16] = "", arg1[16] = "", arg2[16] = "";
+        int used = 0;
+        p = end;
+        if (sscanf(p, " %15s%n", cmd, &used) != 1) { fclose(f); return parse_error(path, line, "missing command"); }
+        p += used;
+        while (*p == ' ' || *p == '\t') p++;     // p now holds the arguments
+
+        if (!strcmp(cmd, "pot")) {
+            sim_at(t, cb_pot, atoi(p));
+        } else if (!strcmp(cmd, "press")) {
+            int button = 0;
+            double hold = 0;
+            char opt[16] = "";
+            if (sscanf(p, "%d %lf %15s", &button, &hold, opt) < 2 || button < 1 || button > 4) {
+                fclose(f);
+                return parse_error(path, line, "usage: press <1..4> <hold_ms> [bounce]");
+            }
+            schedule_press(t, button, hold, !strcmp(opt, "bounce"));
+        } else if (!strcmp(cmd, "uart")) {
+            schedule_uart(t, p);
+        } else if (!strcmp(cmd, "autoplay")) {
+            char opt[16] = "";
+            if (sscanf(p, "%d %15s", &ap.target, opt) < 1) {
+                fclose(f);
+                return parse_error(path, line, "usage: autoplay <rounds> [uart]");
+            }
+            ap.use_uart = !strcmp(opt, "uart");
+            sim_at(t, cb_autoplay_start, 0);
+        } else if (!strcmp(cmd, "end")) {
+            sim_set_end_ms(t);
+        } else if (!strcmp(cmd, "expect")) {
+            GROW(expects, expects_n, expects_cap);
+            expect_t *e = &expects[expects_n];
+            memset(e, 0, sizeof(*e));
+            e->line = line;
+            e->t = t;
+            if (sscanf(p, "%15s%n", arg1, &used) != 1) { fclose(f); return parse_error(path, line, "missing expectation"); }
+            p += used;
+            while (*p == ' ') p++;
+            unsigned l, r;
+            if (!strcmp(arg1, "buzzer") && sscanf(p, "%lf", &e->hz) == 1) {
+                e->kind = EXP_BUZZER;
+            } else if (!strcmp(arg1, "display") && sscanf(p, "%x %x", &l, &r) == 2) {
+                e->kind = EXP_DISPLAY;
+                e->l = (uint8_t)l;
+                e->r = (uint8_t)r;
+            } else if (!strcmp(arg1, "uart")) {
+                e->kind = EXP_UART;
+                copy_text(e->text, p, sizeof(e->text));
+            } else if (!strcmp(arg1, "rounds") && sscanf(p, "%d", &e->n) == 1) {
+                e->kind = EXP_ROUNDS;
+            } else if (!strcmp(arg1, "drift") && sscanf(p, "%d %lf", &e->n, &e->hz) == 2) {
+                e->kind = EXP_DRIFT;
+            } else if (!strcmp(arg1, "latency") && sscanf(p, "%15s %lf", arg2, &e->hz) == 2) {
+                e->kind = EXP_LATENCY;
+                if (!strcmp(arg2, "tcb0")) e->n = 0;
+                else if (!strcmp(arg2, "tcb1")) e->n = 1;
+                else if (!strcmp(arg2, "rxc")) e->n = 3;
+                else { fclose(f); return parse_error(path, line, "latency is tracked for tcb0, tcb1 and rxc"); }
+            } else if (!strcmp(arg1, "retune") && sscanf(p, "%lf", &e->hz) == 1) {
+                e->kind = EXP_RETUNE;
+            } else if (!strcmp(arg1, "cpu") && sscanf(p, "%lf", &e->hz) == 1) {
+                e->kind = EXP_CPU;
+            } else if (!strcmp(arg1, "sequence")) {
+                e->kind = EXP_SEQUENCE;
+                for (char *q = p; *q && e->n < (int)sizeof(e->text); q++) {
+                    if (*q >= '1' && *q <= '4') e->text[e->n++] = (char)(*q - '1');
+                }
+            } else {
+                fclose(f);
+                return parse_error(path, line, "unknown expectation");
+            }
+            expects_n++;
+        } else {
+            fclose(f);
+            return parse_error(path, line, "unknown command");
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+// ---- checking -------------------------------------------------------------- //
+
+static double buzzer_at(double t) {
+    double hz = 0.0;
+    for (size_t k = 0; k < buz_n && buz[k].t <= t; k++) hz = buz[k].hz;
+    return hz;
+}
+
+static void display_at(double t, uint8_t *l, uint8_t *r) {
+    *l = SEGS_BLANK;
+    *r = SEGS_BLANK;
+    for (size_t k = 0; k < disp_n && disp[k].t <= t; k++) {
+        *l = disp[k].l;
+        *r = disp[k].r;
+    }
+}
+
+int replay_finish(void) {
+    int failed = 0;
+    size_t next_line = 0;
+
+    if (rx_len) replay_on_uart((uint64_t)(rx_t / MS_PER_CYCLE), '\n');
+
+    for (size_t k = 0; k < expects_n; k++) {
+        expect_t *e = &expects[k];
+        int ok = 0;
+        char got[96] = "";
+
+        switch (e->kind) {
+            case EXP_BUZZER: {
+                double hz = buzzer_at(e->t);
+                ok = (e->hz == 0.0) ? hz == 0.0 : fabs(hz - e->hz) <= e->hz * 0.01;
+                snprintf(got, sizeof(got), "%.1f Hz", hz);
+                break;
+            }
+            case EXP_DISPLAY: {
+                uint8_t l, r;
+                display_at(e->t, &l, &r);
+                ok = (l == e->l && r == e->r);
+                snprintf(got, sizeof(got), "%02X %02X", l, r);
+                break;
+            }
+            case EXP_UART:
+                while (next_line < lines_n &&
+                       (lines[next_line].t < e->t || strcmp(lines[next_line].text, e->text))) {
+                    next_line++;
+                }
+                ok = next_line < lines_n;
+                if (ok) {
+                    snprintf(got, sizeof(got), "at %.3f ms", lines[next_line].t);
+                    next_line++;
+                } else {
+                    snprintf(got, sizeof(got), "not found");
+                }
+                break;
+            case EXP_ROUNDS:
+                ok = (ap.won == e->n);
+                snprintf(got, sizeof(got), "%d%s", ap.won, ap.failed ? " (failed)" : "");
+                break;
+            case EXP_DRIFT: {
+                // Step k of a playback should start k delays after its
+                // first step and stop half a delay (rounded down) later
+                double t0 = 0.0, worst = 0.0;
+                for (size_t k = 0; k < pb_edges_n; k++) {
+                    int edge = pb_edges[k].edge;
+                    if (edge == 0) t0 = pb_edges[k].t;
+                    double due = t0 + (edge / 2) * e->n + (edge % 2) * (e->n / 2);
+                    if (fabs(pb_edges[k].t - due) > worst) worst = fabs(pb_edges[k].t - due);
+                }
+                ok = pb_edges_n > 0 && worst <= e->hz;
+                snprintf(got, sizeof(got), "%.3f ms over %zu edges", worst, pb_edges_n);
+                break;
+            }
+            case EXP_LATENCY: {
+                double us = sim_isr_latency_max_us(e->n);
+                ok = us <= e->hz;
+                snprintf(got, sizeof(got), "%.1f us", us);
+                break;
+            }
+            case EXP_RETUNE:
+                ok = rt.count > 0 && rt.worst_ms * 1000.0 <= e->hz;
+                snprintf(got, sizeof(got), "%.1f us worst over %d retunes", rt.worst_ms * 1000.0, rt.count);
+                break;
+            case EXP_CPU: {
+                double ms = (double)clock() * 1000.0 / CLOCKS_PER_SEC;
+                ok = ms <= e->hz;
+                snprintf(got, sizeof(got), "%.0f ms host CPU", ms);
+                break;
+            }
+            case EXP_SEQUENCE: {
+                // Steps of the last round autoplay saw, as buttons 1..4
+                ok = (ap.seen >= e->n);
+                for (int s = 0; ok && s < e->n; s++) ok = (ap.steps[s] == (uint8_t)e->text[s]);
+                int n = 0;
+                for (int s = 0; s < ap.seen && n < (int)sizeof(got) - 2; s++) {
+                    got[n++] = (char)('1' + ap.steps[s]);
+                }
+                got[n] = '\0';
+                break;
+            }
+        }
+        if (!ok) failed++;
+        fprintf(stderr, "%s line %d: %s\n", ok ? "PASS" : "FAIL", e->line, got);
+    }
+    return failed;
+}
@@ -0,0 +1,47 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+/* Scripted stimulus and expectations for the host simulator.
+
+   A script has one command per line, each starting with a time in virtual
+   ms, absolute or "+N" relative to the previous line. '#' starts a comment.
+
+     <t> pot <0..255>                  potentiometer position
+     <t> press <1..4> <hold_ms> [bounce]   pushbutton S1..S4, optional contact bounce
+     <t> uart <text>                   bytes to the UART, "\n" for newline
+     <t> autoplay <rounds> [uart]      perfect player: copies each playback using
+                                       the buttons (or UART keys) until <rounds>
+                                       rounds have been won
+     <t> end                           stop the simulation
+     <t> expect buzzer <hz>            buzzer frequency at t (0 = silent, +-1 %)
+     <t> expect display <LL> <RR>      latched segments at t, hex, active low
+     <t> expect uart <text>            next UART line at or after t, in order
+     <t> expect rounds <n>             autoplay won exactly n rounds by the end
+     <t> expect sequence <b b ...>     last playback autoplay saw starts with these
+                                       buttons (1..4)
+     <t> expect drift <delay> <ms>     every tone edge of every autoplay playback
+                                       is within <ms> of its nominal time, step k
+                                       on at k * <delay> from the first step
+     <t> expect latency <vec> <us>     longest wait from interrupt flag to ISR entry
+                                       over the run, vec tcb0, tcb1 or rxc
+     <t> expect retune <us>            octave keys that arrive while a tone sounds
+                                       move it an octave within <us> of the stop
+                                       bit, worst case; needs at least one
+     <t> expect cpu <ms>               the whole run took at most <ms> of host CPU
+                                       time, to catch simulator slowdowns
+
+   Expectations are checked when the run ends; any failure makes the
+   process exit with status 1. */
+
+#include <stdint.h>
+
+int replay_load(const char *path);            // 0 on success
+
+// Simulator observer hooks, forwarded from host/main.c
+void replay_on_buzzer(uint64_t t, double hz);
+void replay_on_display(uint64_t t, uint8_t left, uint8_t right);
+void replay_on_uart(uint64_t t, uint8_t b);
+void replay_on_uart_rx(uint64_t t, uint8_t b);
+int replay_finish(void);                      // number of failed expectations
+
+#endif
@@ -0,0 +1,18 @@
+#!/bin/sh
+# Runs every replay script in host/scenarios against the native build.
+# usage: host/run_scenarios.sh [path/to/simon_host]
+
+BIN=${1:-.pio/build/native/program}
+DIR=$(dirname "$0")/scenarios
+fail=0
+
+for s in "$DIR"/*.txt; do
+    if "$BIN" -q -s "$s" > /dev/null 2>&1; then
+        echo "PASS $(basename "$s" .txt)"
+    else
+        echo "FAIL $(basename "$s" .txt)"
+        fail=1
+    fi
+done
+
+exit $fail
@@ -0,0 +1,44 @@
+#ifndef SIM_H
+#define SIM_H
+
+/* Control surface of the host simulator (host/hal_host.c) for drivers such
+   as host/main.c. Not visible to the firmware. */
+
+#include <stdint.h>
+#include <stdio.h>
+
+typedef void (*sim_callback_t)(intptr_t arg);
+
+typedef struct {
+    void (*buzzer)(uint64_t t, double hz);                  // 0 Hz = silent
+    void (*display)(uint64_t t, uint8_t left, uint8_t right); // latched segments, active low
+    void (*uart_tx)(uint64_t t, uint8_t b);                 // byte left the TX shifter
+    void (*uart_rx)(uint64_t t, uint8_t b);                 // byte landed in RXDATA
+    void (*eeprom)(uint64_t t, const uint8_t *ee);          // after each page write
+    void (*finish)(void);                                   // end time reached
+} sim_observer_t;
+
+double sim_ms(void);
+void sim_set_trace(FILE *f);                 // NULL disables the text trace
+void sim_set_observer(const sim_observer_t *o);
+void sim_set_end_ms(double ms);              // simulation stops (exit(0)) at this time
+void sim_stop(void);                         // stop at the next event
+
+// Run fn(arg) at virtual time t_ms, between firmware instructions, like a
+// stimulus from outside the chip. Callbacks may schedule further callbacks.
+void sim_at(double t_ms, sim_callback_t fn, intptr_t arg);
+
+void sim_set_pot(uint8_t v);                 // 0..255, clockwise = larger
+void sim_set_pins(uint8_t pins);             // PORTA.IN image, buttons active low
+uint8_t sim_get_pins(void);
+void sim_uart_inject(double t_ms, uint8_t b);
+uint32_t sim_uart_bit_cycles(void);
+uint8_t *sim_eeprom(void);
+
+// Longest wait from interrupt flag to vector entry so far. Tracked for
+// 0 TCB0_INT, 1 TCB1_INT and 3 USART0_RXC.
+double sim_isr_latency_max_us(int idx);
+
+void sim_print_stats(FILE *f, double wall_s);
+
+#endif
@@ -0,0 +1,229 @@
+/* Perfect game to the 16-bit length limit, without real-time playback.
+
+   simon_soak [-n rounds]
+
+   Drives game.c directly against the simulated QUTy: TCB0 is never
+   started, so uptime_ms and elapsed_time are stepped here half a playback
+   delay at a time, and answers go straight into the input FIFO as UART
+   keys. Each tone game.c plays is checked against a reference LFSR.
+
+   Rounds 1..n (default 300, past the old 8-bit wrap) are played in full.
+   The game then skips to round 65533, which is equivalent because a round
+   is only (len, round_start_state), and plays 65533, 65534 and 65535
+   twice, since the length saturates there. A final 65535 round is failed
+   on its first step. The run checks:
+     - every playback and echo against the reference sequence,
+     - "SUCCESS" / "GAME OVER" with the full score on the UART,
+     - the two low digits of 65535 on the fail display,
+     - that the next game starts 65535 steps into the LFSR, though only
+       one step was checked.
+   Per-round host time is printed for the long rounds; the step cost
+   should not depend on the length. Exits with status 1 on any mismatch. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hal.h"
+#include "sim.h"
+#include "profile.h"
+#include "latency.h"
+
+#if PROFILE || LATENCY
+#error "PROFILE and LATENCY read TCB0, which the soak never starts"
+#endif
+
+// Everything game.c shows passes through here first
+#define buzzer_on(step)             soak_tone(step)
+#define set_display_segments(l, r)  soak_display(l, r)
+static void soak_tone(uint8_t step);
+static void soak_display(uint8_t l, uint8_t r);
+
+#include "../../src/game.c"
+
+#undef buzzer_on
+#undef set_display_segments
+#undef main
+void buzzer_on(uint8_t step);
+void set_display_segments(uint8_t segs_l, uint8_t segs_r);
+
+#define SOAK_MAX_LEN    0xFFFFu
+#define SOAK_TICK_MS    (MIN_PLAYBACK_DELAY / 2)    // pot 0: every timeout is a multiple
+
+static uint8_t ref[SOAK_MAX_LEN + 1];   // reference steps, one past the top length
+static uint32_t played, echoed;         // tones seen this round
+static int8_t answer = -1;              // key last pushed
+static uint8_t disp_l, disp_r;
+static int errors;
+static uint16_t idle_passes;            // since the outputs last changed
+
+static char uart_line[32], uart_last[2][32];
+static uint8_t uart_len;
+
+static void fail(const char *what, long a, long b) {
+    fprintf(stderr, "FAIL round %u: %s (%ld, expected %ld)\n", len, what, a, b);
+    if (++errors > 10) exit(1);
+}
+
+// Same LFSR as sequencing.c, kept separate so the two can disagree
+static void ref_generate(void) {
+    uint32_t s = GAME_SEED;
+    for (uint32_t k = 0; k <= SOAK_MAX_LEN; k++) {
+        uint8_t bit = s & 1u;
+        s >>= 1;
+        if (bit) s ^= 0xE2025CABu;
+        ref[k] = s & 0x03u;
+    }
+}
+
+static void soak_tone(uint8_t step) {
+    idle_passes = 0;
+    if (state == INPUT_WAITING) {
+        if (step != (uint8_t)answer) fail("echo", step, answer);
+        echoed++;
+    } else {
+        if (played > SOAK_MAX_LEN || step != ref[played]) fail("playback step", step, ref[played]);
+        played++;
+    }
+    buzzer_on(step);
+}
+
+static void soak_display(uint8_t l, uint8_t r) {
+    idle_passes = 0;
+    disp_l = l;
+    disp_r = r;
+    set_display_segments(l, r);
+}
+
+static void on_uart_tx(uint64_t t, uint8_t b) {
+    (void)t;
+    if (b != '\n') {
+        if (uart_len < sizeof(uart_line) - 1) uart_line[uart_len++] = (char)b;
+        return;
+    }
+    uart_line[uart_len] = '\0';
+    memcpy(uart_last[0], uart_last[1], sizeof(uart_last[0]));
+    memcpy(uart_last[1], uart_line, sizeof(uart_last[1]));
+    uart_len = 0;
+}
+
+// Long enough for a full 32-byte TX ring and the shifter to empty
+static void uart_flush(void) {
+    hal_host_advance(sim_uart_bit_cycles() * 10 * 34);
+}
+
+static void expect_uart(const char *result) {
+    char score[8];
+    uart_flush();
+    snprintf(score, sizeof(score), "%u", len);
+    if (strcmp(uart_last[0], result) || strcmp(uart_last[1], score)) {
+        fprintf(stderr, "FAIL round %u: uart \"%s\" \"%s\", expected \"%s\" \"%s\"\n",
+                len, uart_last[0], uart_last[1], result, score);
+        if (++errors > 10) exit(1);
+    }
+}
+
+// One main loop pass, then half a delay of virtual time
+static void pass(void) {
+    if (++idle_passes > 1000) {
+        fail("stalled in state", state, -1);
+        exit(1);
+    }
+    hal_idle();
+    game_service();
+    uptime_ms += SOAK_TICK_MS;
+    elapsed_time += SOAK_TICK_MS;
+}
+
+static double now_s(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+// Plays one round; answers it perfectly, or wrongly on the first step
+static void play_round(int miss) {
+    played = echoed = 0;
+    while (state != INPUT_WAITING) pass();
+    if (played != len) fail("steps played", (long)played, len);
+
+    uint16_t k = 0;
+    do {
+        answer = (int8_t)(miss ? (ref[k] + 1) & 3 : ref[k]);
+        input_push(INPUT_SRC_UART, (uint8_t)answer, INPUT_PRESS);
+        while (state == INPUT_WAITING) pass();
+        while (state == INPUT_ECHO_ON) pass();
+    } while (++k < len && state == INPUT_WAITING);
+    if (echoed != (miss ? 1u : len)) fail("echoes", (long)echoed, miss ? 1 : len);
+}
+
+static void timed_round(int miss) {
+    double t0 = now_s();
+    play_round(miss);
+    double ms = (now_s() - t0) * 1e3;
+    printf("round %5u  %8.1f ms host  %5.0f ns/step\n", len, ms, ms * 1e6 / len);
+}
+
+// Plays one winning round through to the next PLAYBACK_START
+static void win_round(int timed) {
+    if (timed) timed_round(0);
+    else play_round(0);
+    while (state != PLAYBACK_START) pass();
+    expect_uart("SUCCESS");
+}
+
+int main(int argc, char **argv) {
+    uint16_t early = 300;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        if (opt == 'n') early = (uint16_t)atoi(optarg);
+        else {
+            fprintf(stderr, "usage: %s [-n rounds]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    sim_set_trace(NULL);
+    sim_observer_t obs = { .uart_tx = on_uart_tx };
+    sim_set_observer(&obs);
+    ref_generate();
+
+    // The initialisation() of main.c, minus the timers
+    cli();
+    buzzer_init();
+    adc_init();
+    display_init();
+    uart_init();
+    sequencing_init(GAME_SEED);
+    highscore_load();
+    sei();
+    game_init();
+
+    for (uint16_t r = 1; r <= early; r++) win_round(r == 256 || r == early);
+
+    // Every round replays from round_start_state, so having won round n is
+    // only len == n; skip to just below the limit
+    len = SOAK_MAX_LEN - 3;
+    for (uint8_t r = 0; r < 4; r++) win_round(1);
+    if (len != SOAK_MAX_LEN) fail("saturated length", len, SOAK_MAX_LEN);
+
+    play_round(1);
+    while (state != FAIL_SCORE_SHOW) pass();
+    expect_uart("GAME OVER");
+    if (disp_l != digit_masks[3] || disp_r != digit_masks[5]) {
+        fail("fail display", disp_l << 8 | disp_r, digit_masks[3] << 8 | digit_masks[5]);
+    }
+
+    // Past the failed sequence, through the high score prompt: the next
+    // game's first step is step 65536
+    played = SOAK_MAX_LEN;
+    while (state != PLAYBACK_STEP_ON) pass();
+    if (played != SOAK_MAX_LEN + 1) fail("next game started", (long)played, SOAK_MAX_LEN + 1);
+
+    if (errors) return 1;
+    printf("PASS: perfect game to %u, score and LFSR replay correct at the limit\n", SOAK_MAX_LEN);
+    return 0;
+}
@@ -3,12 +3,15 @@
 #define ADC_H
 
 #include <stdint.h>
+#include "hal.h"
 
 /* Configure ADC0 for 8-bit free-running reads on the POT (AIN2), safe at 20 MHz */
 void adc_init(void);
 
 /* Read current 8-bit ADC sample (0..255); clockwise ≈ larger value on QUTy */
-uint8_t adc_read8(void);
+static inline uint8_t adc_read8(void) {
+    return hal_adc_read8();
+}
 
 /* Map 0..255 -> 250..2000 ms (linear). Clockwise => longer delay. */
 static inline uint16_t playback_delay_ms_from_adc8(uint8_t x)
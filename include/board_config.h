@@ -0,0 +1,73 @@
+#ifndef BOARD_CONFIG_H
+#define BOARD_CONFIG_H
+
+/* Clock tree of the QUTy board. Every timer top, tone period, baud value
+   and ADC setting is derived here from F_CPU and the prescalers below, so
+   building with a different F_CPU (e.g. -DF_CPU=20000000UL, which needs
+   VDD >= 4.5 V) retimes everything at once. F_CPU must be the 20 MHz
+   oscillator divided by one of the main clock prescaler steps;
+   hal_clock_init() selects that prescaler at start-up. The checks below
+   fail the build for clocks a register cannot reach. */
+
+#ifndef F_CPU
+#define F_CPU 3333333UL
+#endif
+
+#define BOARD_OSC_HZ        20000000UL
+#define BOARD_CLK_PDIV      ((BOARD_OSC_HZ + F_CPU / 2) / F_CPU)
+
+_Static_assert(BOARD_CLK_PDIV == 1 || BOARD_CLK_PDIV == 2 || BOARD_CLK_PDIV == 4 ||
+               BOARD_CLK_PDIV == 6 || BOARD_CLK_PDIV == 8 || BOARD_CLK_PDIV == 10 ||
+               BOARD_CLK_PDIV == 12 || BOARD_CLK_PDIV == 16 || BOARD_CLK_PDIV == 24 ||
+               BOARD_CLK_PDIV == 32 || BOARD_CLK_PDIV == 48 || BOARD_CLK_PDIV == 64,
+               "F_CPU is not 20 MHz over a main clock prescaler step");
+_Static_assert(BOARD_OSC_HZ / BOARD_CLK_PDIV + 1 >= F_CPU && F_CPU + 1 >= BOARD_OSC_HZ / BOARD_CLK_PDIV,
+               "F_CPU does not match 20 MHz over the prescaler");
+
+// Rounded integer division for the derivations below
+#define BOARD_DIV_ROUND(n, d)   (((n) + (d) / 2) / (d))
+
+// TCB0: 1 ms tick (uptime_ms, elapsed_time), CLK_PER undivided. When
+// F_CPU is not a whole number of kHz, TIMER_TICK_REM ticks a second are
+// one cycle longer, so the tick keeps exact time on average.
+#define TIMER_TICK_HZ       1000UL
+#define TIMER_CCMP          (F_CPU / TIMER_TICK_HZ - 1)
+#define TIMER_TICK_REM      (F_CPU % TIMER_TICK_HZ)
+
+_Static_assert(TIMER_CCMP >= 100 && TIMER_CCMP <= 0xFFFF, "TCB0 cannot make a 1 ms tick at F_CPU");
+
+// TCB1: 5 ms display multiplex and debounce tick, CLK_PER/2 once
+// CLK_PER/1 would overflow the 16-bit compare
+#define BUTTONS_TICK_HZ     200UL
+#define BUTTONS_TCB_DIV2    (BOARD_DIV_ROUND(F_CPU, BUTTONS_TICK_HZ) > 0x10000UL)
+#define BUTTONS_CCMP        (BOARD_DIV_ROUND(F_CPU, BUTTONS_TICK_HZ << BUTTONS_TCB_DIV2) - 1)
+
+_Static_assert(BUTTONS_CCMP <= 0xFFFF, "TCB1 cannot make a 5 ms tick at F_CPU");
+
+// TCA0: buzzer PWM at CLK_PER / BUZZER_TCA_DIV, single slope, so a tone of
+// f Hz has a period of BUZZER_PERIOD(f) counts and PER = period - 1. The
+// prescaler is the smallest step that still lets 16 bits reach 40 Hz, two
+// octaves below the lowest tone.
+#define BUZZER_PERIOD_MAX   0x10000UL
+#define BUZZER_CLK_MAX_HZ   (BUZZER_PERIOD_MAX * 40UL)
+#define BUZZER_TCA_DIV      (F_CPU <= BUZZER_CLK_MAX_HZ ? 1 : F_CPU / 2 <= BUZZER_CLK_MAX_HZ ? 2 : \
+                             F_CPU / 4 <= BUZZER_CLK_MAX_HZ ? 4 : F_CPU / 8 <= BUZZER_CLK_MAX_HZ ? 8 : 16)
+#define BUZZER_CLK_HZ       (F_CPU / BUZZER_TCA_DIV)
+#define BUZZER_PERIOD(hz)   BOARD_DIV_ROUND(BUZZER_CLK_HZ, (hz))
+#define BUZZER_PERIOD_MIN   BUZZER_PERIOD(20000UL)  // top of human hearing
+
+_Static_assert(BUZZER_PERIOD_MIN >= 4, "TCA0 clock too slow for 20 kHz");
+
+// ADC0: CLK_ADC at most ADC_CLK_MAX_HZ from an even prescaler (DIV2..DIV16
+// encode as DIV/2 - 1), TIMEBASE = CLK_PER cycles in 1 us, rounded up
+#define ADC_CLK_MAX_HZ      2000000UL
+#define ADC_DIV             (((F_CPU + 2 * ADC_CLK_MAX_HZ - 1) / (2 * ADC_CLK_MAX_HZ)) * 2)
+#define ADC_PRESC_CODE      (ADC_DIV / 2 - 1)
+#define ADC_TIMEBASE        ((F_CPU + 999999UL) / 1000000UL)
+
+_Static_assert(ADC_DIV >= 2 && ADC_DIV <= 16, "no ADC prescaler step for F_CPU");
+_Static_assert(ADC_TIMEBASE <= 31, "ADC TIMEBASE field is 5 bits");
+
+// USART0 BAUD values come from F_CPU in uart.h (UART_BAUD_REG)
+
+#endif
@@ -3,6 +3,32 @@
 
 #include <stdint.h>
 
+/* PA4..PA7 are debounced in software by default: a vertical counter in the
+   5 ms TCB1 ISR accepts a change after three equal samples (10-15 ms).
+   Build with -DPB_HW_DEBOUNCE=1 to filter them in hardware instead: the
+   event system routes each pin through a CCL LUT filter clocked at 256 Hz
+   and the CCL interrupt updates pb_debounced on clean edges only, 12-16 ms
+   after the contacts settle. TCB1 then only multiplexes the display. */
+#ifndef PB_HW_DEBOUNCE
+#define PB_HW_DEBOUNCE 0
+#endif
+
+/* Build with -DPB_SPECULATE=1 to echo a press from its first raw falling
+   edge instead of waiting for the debouncer. The PA4..PA7 pin-change
+   interrupt records the edge, and the next main loop pass in INPUT_WAITING
+   starts that button's tone and segments. The input itself still only
+   counts once the debounced press arrives. If no press of that button
+   arrives within PB_SPECULATE_MS, the edge was a glitch and the outputs
+   go quietly off again. "!spec" prints the started, committed and rolled
+   back counts. */
+#ifndef PB_SPECULATE
+#define PB_SPECULATE 0
+#endif
+
+/* Falling edges of released buttons seen by the pin-change interrupt since
+   the game loop last cleared them (LATENCY or PB_SPECULATE builds) */
+extern volatile uint8_t pb_raw_falling;
+
 /* Initialise PA4..PA7 with pull-ups */
 void   buttons_init(void);
 
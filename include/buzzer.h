@@ -11,9 +11,15 @@ void buzzer_stop(void);
 void buzzer_on(uint8_t tone_index);
 void buzzer_off(void);
 
-/* Octave controls */
+/* Octave controls, safe from the UART RX ISR. A Simon tone that is
+   sounding moves to the new octave at its next TCA0 period. From the
+   RXC vector to the PERBUF write is 135 cycles (41 us at 3.33 MHz),
+   938 cycles (281 us) if TCB0 is running and TCB1 cuts in; counted from
+   the compiled code with tools/isr_budget.py, not measured on hardware. */
 void increase_octave(void);
 void decrease_octave(void);
+void reset_octave(void);
+int8_t buzzer_get_octave(void);
 
 
 #endif
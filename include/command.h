@@ -0,0 +1,14 @@
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include <stdint.h>
+
+/* Extended UART commands, sent as '!' <name> [' ' <arg>] '\n'.
+   Game keys are unaffected; the RX ISR only buffers the line and
+   command_service() runs the handler from the main loop. */
+void command_service(void);
+
+/* Parse an unsigned decimal argument, returns 0 if empty or invalid */
+uint32_t command_parse_u32(const char *s);
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef FLIGHTREC_H
+#define FLIGHTREC_H
+
+#include <stdint.h>
+
+/* Build with -DFLIGHTREC=1 for a flight recorder that survives resets.
+   The last FR_ENTRIES events live in a ring in .noinit SRAM, so they are
+   still there after a watchdog, software, brown-out or external reset:
+       reset   RSTCTRL.RSTFR at boot
+       state   every game state transition (game.c)
+       input   every button and UART input queued (input.c)
+   each as 4 bytes (kind, value, low 16 bits of uptime_ms), written with
+   interrupts off in a few dozen cycles. flightrec_init() keeps the ring
+   if it is intact and the reset was not a power-on, then adds the reset
+   record. "!fr" prints the number of records, then the records oldest
+   first, one row per main loop pass as the TX ring has room; "!fr 0"
+   empties it. With FLIGHTREC 0 nothing is
+   built and the hooks compile away. */
+#ifndef FLIGHTREC
+#define FLIGHTREC 0
+#endif
+
+#define FR_ENTRIES 32                   // must be a power of two
+
+typedef enum {
+    FR_RESET,       // value: RSTCTRL.RSTFR
+    FR_STATE,       // value: new Game_State
+    FR_INPUT        // value: source << 3 | edge << 2 | button (input.h)
+} fr_kind_t;
+
+#if FLIGHTREC
+
+void flightrec_init(uint8_t reset_flags);           // first thing at boot, hal_reset_flags()
+void flightrec_record(uint8_t kind, uint8_t value); // safe from ISRs
+
+/* Prints one row of a pending dump. Call once per main loop pass. */
+void flightrec_service(void);
+
+void flightrec_dump(void);
+void flightrec_clear(void);
+
+#else
+
+#define flightrec_init(reset_flags)     ((void)(reset_flags))
+#define flightrec_record(kind, value)   ((void)0)
+#define flightrec_service()             ((void)0)
+
+#endif
+
+#endif
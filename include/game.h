@@ -0,0 +1,58 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include <stdint.h>
+
+#define GAME_SEED 0x11993251u       // student number, also restored by RESET
+
+/* The Simon game as a (state x event) -> (action, next state) table in
+   flash, see src/game.c. Each main loop pass turns inputs and timers into
+   events and looks each one up once. */
+typedef enum {
+    PLAYBACK_START,
+    PLAYBACK_STEP_ON,
+    PLAYBACK_STEP_OFF,
+    INPUT_WAITING,
+    INPUT_ECHO_ON,
+    SUCCESS_SHOW,
+    FAIL_SHOW,
+    FAIL_SCORE_SHOW,
+    FAIL_WAIT,
+    HS_PROMPT,
+    HS_NAME_ENTRY,
+    HS_PRINT,
+    GAME_NUM_STATES
+} Game_State;
+
+typedef enum {
+    EV_NONE,
+    EV_TIMEOUT,         // the state's delay has run out (see state_timeout)
+    EV_POLL,            // every pass, for states that poll
+    EV_BUTTON_0,        // debounced press of S1..S4
+    EV_BUTTON_1,
+    EV_BUTTON_2,
+    EV_BUTTON_3,
+    EV_UART_0,          // gameplay keys '1'..'4' / 'q' 'w' 'e' 'r'
+    EV_UART_1,
+    EV_UART_2,
+    EV_UART_3,
+    EV_RELEASE,         // the button being echoed was released
+    EV_RESET,           // RESET key '0' / 'p'
+    EV_NEXT,            // outcomes returned by actions
+    EV_DONE,
+    EV_FAIL,
+    GAME_NUM_EVENTS
+} game_event_t;
+
+void game_init(void);
+
+/* Generates and dispatches this pass's events. Call once per main loop pass. */
+void game_service(void);
+
+Game_State game_state(void);
+
+#if PB_SPECULATE
+void game_spec_report(void);        // "!spec", see buttons.h
+#endif
+
+#endif
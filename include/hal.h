@@ -0,0 +1,23 @@
+#ifndef HAL_H
+#define HAL_H
+
+/* Hardware abstraction layer.
+   Firmware modules include this instead of <avr/io.h> and touch peripherals
+   only through the hal_* calls below. On the QUTy every call is a static
+   inline register access (hal_avr.h), so the AVR build is unchanged. With
+   -DHAL_HOST the same sources build natively against host/hal_host.c, which
+   simulates the peripherals in virtual time.
+
+   Both backends also provide cli()/sei(), ISR(), ATOMIC_BLOCK(), PROGMEM,
+   PSTR() and the pgm_read_* / *_P helpers used by the firmware, and
+   TLOG_TOKEN() for tlog.h. */
+
+#include "board_config.h"
+
+#ifdef HAL_HOST
+#include "hal_host.h"
+#else
+#include "hal_avr.h"
+#endif
+
+#endif
@@ -0,0 +1,315 @@
+#ifndef HAL_AVR_H
+#define HAL_AVR_H
+
+/* ATtiny1626 (QUTy) backend for hal.h. Everything is static inline. */
+
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <avr/cpufunc.h>
+#include <avr/wdt.h>
+#include <util/atomic.h>
+
+// Token for a TLOG format string (tlog.h): its address in .tlog, which
+// tools/tlog.ld links as a non-loaded section at 0, so the text never
+// reaches flash
+#define TLOG_TOKEN(s) __extension__({ \
+        static const char tlog_fmt_[] __attribute__((section(".tlog"), used)) = (s); \
+        (uint16_t)(uintptr_t)tlog_fmt_; })
+
+// Main loop hook, only does something on the host
+static inline void hal_idle(void) {}
+
+// TCB0/TCB1 periodic interrupt
+#define HAL_TCB(n) ((n) ? &TCB1 : &TCB0)
+
+// Main clock prescaler for F_CPU (board_config.h); reset leaves it at 6
+static inline void hal_clock_init(void) {
+    uint8_t pdiv;
+    switch (BOARD_CLK_PDIV) {
+        case 2:  pdiv = CLKCTRL_PDIV_2X_gc;  break;
+        case 4:  pdiv = CLKCTRL_PDIV_4X_gc;  break;
+        case 8:  pdiv = CLKCTRL_PDIV_8X_gc;  break;
+        case 10: pdiv = CLKCTRL_PDIV_10X_gc; break;
+        case 12: pdiv = CLKCTRL_PDIV_12X_gc; break;
+        case 16: pdiv = CLKCTRL_PDIV_16X_gc; break;
+        case 24: pdiv = CLKCTRL_PDIV_24X_gc; break;
+        case 32: pdiv = CLKCTRL_PDIV_32X_gc; break;
+        case 48: pdiv = CLKCTRL_PDIV_48X_gc; break;
+        case 64: pdiv = CLKCTRL_PDIV_64X_gc; break;
+        default: pdiv = CLKCTRL_PDIV_6X_gc;  break;
+    }
+    ccp_write_io((void *)&CLKCTRL.MCLKCTRLB, (BOARD_CLK_PDIV == 1) ? 0 : (pdiv | CLKCTRL_PEN_bm));
+}
+
+// TCB1 (display and debounce tick) at level 1, round robin at level 0,
+// see irq.h
+static inline void hal_irq_priority_init(void) {
+    CPUINT.LVL1VEC = TCB1_INT_vect_num;
+    ccp_write_io((void *)&CPUINT.CTRLA, CPUINT_LVL0RR_bm);
+}
+
+// Reset cause, RSTCTRL.RSTFR, cleared so the next reset reports only its
+// own. Statics marked HAL_NOINIT keep their contents over any reset but
+// power-on.
+#define HAL_RESET_POWER_ON  RSTCTRL_PORF_bm
+#define HAL_RESET_WATCHDOG  RSTCTRL_WDRF_bm
+#define HAL_NOINIT          __attribute__((section(".noinit")))
+
+static inline uint8_t hal_reset_flags(void) {
+    uint8_t flags = RSTCTRL.RSTFR;
+    RSTCTRL.RSTFR = flags;
+    return flags;
+}
+
+// Watchdog in normal mode, resetting the chip unless hal_wdt_reset() runs
+// at least every `ms` (8..8192, a power of two; the 1.024 kHz OSCULP32K
+// makes the real limit 2.4 % shorter)
+static inline void hal_wdt_enable(uint16_t ms) {
+    uint8_t period = WDT_PERIOD_8CLK_gc;
+    for (uint16_t m = 8; m < ms && period < WDT_PERIOD_8KCLK_gc; m <<= 1) period++;
+    ccp_write_io((void *)&WDT.CTRLA, period);
+}
+
+static inline void hal_wdt_reset(void) {
+    wdt_reset();
+}
+
+// div2 clocks the timer from CLK_PER/2 for periods past 65536 cycles
+static inline void hal_tcb_init_periodic(uint8_t n, uint16_t ccmp, uint8_t div2) {
+    TCB_t *t = HAL_TCB(n);
+    t->CTRLA    = 0;
+    t->CNT      = 0;
+    t->CCMP     = ccmp;
+    t->CTRLB    = TCB_CNTMODE_INT_gc;
+    t->INTFLAGS = TCB_CAPT_bm;
+    t->INTCTRL  = TCB_CAPT_bm;
+    t->CTRLA    = (div2 ? TCB_CLKSEL_DIV2_gc : TCB_CLKSEL_DIV1_gc) | TCB_ENABLE_bm;
+}
+
+static inline void hal_tcb_ack(uint8_t n) {
+    HAL_TCB(n)->INTFLAGS = TCB_CAPT_bm;
+}
+
+// New top for the period in progress; call early in the period
+static inline void hal_tcb_set_top(uint8_t n, uint16_t ccmp) {
+    HAL_TCB(n)->CCMP = ccmp;
+}
+
+// Free-running count, 0..CCMP, in CLK_PER cycles
+static inline uint16_t hal_tcb_count(uint8_t n) {
+    return HAL_TCB(n)->CNT;
+}
+
+// Compare match not yet serviced
+static inline uint8_t hal_tcb_pending(uint8_t n) {
+    return HAL_TCB(n)->INTFLAGS & TCB_CAPT_bm;
+}
+
+// Pushbuttons S1..S4 on PA4..PA7, active low
+static inline void hal_buttons_init(void) {
+    // already configured as inputs by default, enable internal pull-ups
+    PORTA.PIN4CTRL = PORT_PULLUPEN_bm;
+    PORTA.PIN5CTRL = PORT_PULLUPEN_bm;
+    PORTA.PIN6CTRL = PORT_PULLUPEN_bm;
+    PORTA.PIN7CTRL = PORT_PULLUPEN_bm;
+}
+
+static inline uint8_t hal_buttons_read(void) {
+    return PORTA.IN;
+}
+
+// Pin-change interrupt on the falling (press) edge of PA4..PA7
+static inline void hal_buttons_irq_init(void) {
+    PORTA.PIN4CTRL = PORT_PULLUPEN_bm | PORT_ISC_FALLING_gc;
+    PORTA.PIN5CTRL = PORT_PULLUPEN_bm | PORT_ISC_FALLING_gc;
+    PORTA.PIN6CTRL = PORT_PULLUPEN_bm | PORT_ISC_FALLING_gc;
+    PORTA.PIN7CTRL = PORT_PULLUPEN_bm | PORT_ISC_FALLING_gc;
+}
+
+// Returns and clears the pending pin-change flags
+static inline uint8_t hal_buttons_irq_ack(void) {
+    uint8_t flags = PORTA.INTFLAGS & 0xF0;
+    PORTA.INTFLAGS = flags;
+    return flags;
+}
+
+// Hardware debounce: PA4..PA7 -> EVSYS channels 0..3 -> EVENTA of CCL
+// LUT0..3. Each LUT passes IN0 through its filter (an input must be stable
+// for two filter clocks after a two-stage synchroniser), clocked from IN2 =
+// EVENTB = RTC PIT at 32768 Hz / 128 = 256 Hz on channel 5. CCL_CCL_vect
+// fires only on filtered edges. The CCL has no readable LUT output, so the
+// ISR re-reads the pins for the flagged bits.
+// ATtiny1626 EVSYS generators: PORTA pins exist on channels 0..3 (0/1 with
+// PORTB, 2/3 with PORTC), RTC_PIT DIV8192..DIV1024 on the even channels and
+// DIV512..DIV64 on the odd ones, hence DIV128 on channel 5.
+#define HAL_PB_FILTER_HZ 256
+
+#define HAL_CCL_LUT_FILTER(n)                                               \
+    do {                                                                    \
+        CCL.LUT##n##CTRLB = CCL_INSEL0_EVENTA_gc | CCL_INSEL1_MASK_gc;      \
+        CCL.LUT##n##CTRLC = CCL_INSEL2_EVENTB_gc;                           \
+        CCL.TRUTH##n = 0xAA;                    /* out = IN0 */             \
+        CCL.LUT##n##CTRLA = CCL_CLKSRC_IN2_gc | CCL_FILTSEL_FILTER_gc | CCL_ENABLE_bm; \
+    } while (0)
+
+static inline void hal_buttons_filter_init(void) {
+    RTC.CLKSEL = RTC_CLKSEL_INT32K_gc;
+    RTC.PITCTRLA = RTC_PITEN_bm;
+
+    EVSYS.CHANNEL0 = EVSYS_CHANNEL0_PORTA_PIN4_gc;
+    EVSYS.CHANNEL1 = EVSYS_CHANNEL1_PORTA_PIN5_gc;
+    EVSYS.CHANNEL2 = EVSYS_CHANNEL2_PORTA_PIN6_gc;
+    EVSYS.CHANNEL3 = EVSYS_CHANNEL3_PORTA_PIN7_gc;
+    EVSYS.CHANNEL5 = EVSYS_CHANNEL5_RTC_PIT_DIV128_gc;
+    EVSYS.USERCCLLUT0A = EVSYS_USER_CHANNEL0_gc;
+    EVSYS.USERCCLLUT1A = EVSYS_USER_CHANNEL1_gc;
+    EVSYS.USERCCLLUT2A = EVSYS_USER_CHANNEL2_gc;
+    EVSYS.USERCCLLUT3A = EVSYS_USER_CHANNEL3_gc;
+    EVSYS.USERCCLLUT0B = EVSYS_USER_CHANNEL5_gc;
+    EVSYS.USERCCLLUT1B = EVSYS_USER_CHANNEL5_gc;
+    EVSYS.USERCCLLUT2B = EVSYS_USER_CHANNEL5_gc;
+    EVSYS.USERCCLLUT3B = EVSYS_USER_CHANNEL5_gc;
+
+    // LUTs can only be configured while the CCL is off
+    CCL.CTRLA = 0;
+    HAL_CCL_LUT_FILTER(0);
+    HAL_CCL_LUT_FILTER(1);
+    HAL_CCL_LUT_FILTER(2);
+    HAL_CCL_LUT_FILTER(3);
+    CCL.INTCTRL0 = CCL_INTMODE0_BOTH_gc | CCL_INTMODE1_BOTH_gc | CCL_INTMODE2_BOTH_gc | CCL_INTMODE3_BOTH_gc;
+    CCL.INTFLAGS = CCL_INT0_bm | CCL_INT1_bm | CCL_INT2_bm | CCL_INT3_bm;
+    CCL.CTRLA = CCL_ENABLE_bm;
+}
+
+// Returns and clears the filtered edges, LUTn as bit 4 + n like PORTA
+static inline uint8_t hal_buttons_filter_ack(void) {
+    uint8_t flags = CCL.INTFLAGS & (CCL_INT0_bm | CCL_INT1_bm | CCL_INT2_bm | CCL_INT3_bm);
+    CCL.INTFLAGS = flags;
+    return (uint8_t)(flags << 4);
+}
+
+// TCA0 CLKSEL steps: DIV1, 2, 4, 8, 16, 64, 256, 1024
+#define HAL_TCA_CLKSEL(div) ((div) == 1 ? 0 : (div) == 2 ? 1 : (div) == 4 ? 2 : (div) == 8 ? 3 : \
+                             (div) == 16 ? 4 : (div) == 64 ? 5 : (div) == 256 ? 6 : 7)
+
+// Buzzer on PB0, TCA0 single-slope PWM clocked at CLK_PER/BUZZER_TCA_DIV
+static inline void hal_buzzer_init(void) {
+    PORTB.OUTCLR = PIN0_bm; // buzzer off initially
+    PORTB.DIRSET = PIN0_bm; // Enable PB0 as output
+
+    TCA0.SINGLE.CTRLA = HAL_TCA_CLKSEL(BUZZER_TCA_DIV) << TCA_SINGLE_CLKSEL_gp;
+    TCA0.SINGLE.CTRLB = TCA_SINGLE_WGMODE_SINGLESLOPE_gc | TCA_SINGLE_CMP0EN_bm;
+    TCA0.SINGLE.PER = 1;
+    TCA0.SINGLE.CMP0 = 0;
+    TCA0.SINGLE.CTRLA |= TCA_SINGLE_ENABLE_bm;
+}
+
+static inline void hal_buzzer_set(uint16_t per, uint16_t cmp) {
+    TCA0.SINGLE.PERBUF = per;
+    TCA0.SINGLE.CMP0BUF = cmp;
+}
+
+static inline void hal_buzzer_mute(void) {
+    TCA0.SINGLE.CMP0BUF = 0;
+}
+
+// 7-segment display: SPI0 (alt pins PC0/PC2) into a shift register, latched on PA1
+static inline void hal_display_init(void) {
+    PORTMUX.SPIROUTEA = PORTMUX_SPI0_ALT1_gc;  // SPI pins on PC0-3
+    PORTC.DIRSET = (PIN0_bm | PIN2_bm);        // SCK (PC0) and MOSI (PC2) output
+    PORTA.OUTSET = PIN1_bm;                    // DISP_LATCH initial high
+    PORTA.DIRSET = PIN1_bm;
+
+    SPI0.CTRLA = SPI_MASTER_bm;    // Master, /4 prescaler, MSB first
+    SPI0.CTRLB = SPI_SSD_bm;       // Mode 0, client select disable, unbuffered
+    SPI0.INTCTRL = SPI_IE_bm;      // Interrupt enable
+    SPI0.CTRLA |= SPI_ENABLE_bm;
+}
+
+static inline void hal_spi_write(uint8_t data) {
+    SPI0.DATA = data;
+}
+
+// Called from SPI0_INT_vect once the byte has been shifted out
+static inline void hal_display_latch(void) {
+    PORTA.OUTCLR = PIN1_bm;
+    PORTA.OUTSET = PIN1_bm;
+    SPI0.INTFLAGS = SPI_IF_bm;
+}
+
+// Potentiometer on AIN2, free running 8-bit conversions
+static inline void hal_adc_init_pot(void) {
+    ADC0.CTRLA = ADC_ENABLE_bm;
+    ADC0.CTRLB = ADC_PRESC_CODE;
+    // TIMEBASE CLK_PER cycles make 1us, select VDD as ref
+    ADC0.CTRLC = (ADC_TIMEBASE << ADC_TIMEBASE_gp) | ADC_REFSEL_VDD_gc;
+    ADC0.CTRLE = 64;                               // Sample duration of 64
+    ADC0.CTRLF = ADC_FREERUN_bm;
+    ADC0.MUXPOS = ADC_MUXPOS_AIN2_gc;
+    ADC0.COMMAND = ADC_MODE_SINGLE_8BIT_gc | ADC_START_IMMEDIATE_gc;
+}
+
+static inline uint8_t hal_adc_read8(void) {
+    return (uint8_t)ADC0.RESULT;
+}
+
+// USART0, TX on PB2
+static inline void hal_uart_init(void) {
+    PORTB.DIRSET = PIN2_bm;
+    USART0.CTRLA = USART_RXCIE_bm;
+}
+
+static inline void hal_uart_set_baud(uint16_t baud, uint8_t clk2x) {
+    USART0.BAUD = baud;
+    USART0.CTRLB = USART_RXEN_bm | USART_TXEN_bm |
+                   (clk2x ? USART_RXMODE_CLK2X_gc : USART_RXMODE_NORMAL_gc);
+}
+
+static inline uint8_t hal_uart_rx_ready(void) {
+    return (USART0.STATUS & USART_RXCIF_bm) ? 1u : 0u;
+}
+
+static inline uint8_t hal_uart_rx_byte(void) {
+    return USART0.RXDATAL;
+}
+
+static inline void hal_uart_tx_byte(uint8_t c) {
+    USART0.TXDATAL = c;
+}
+
+static inline void hal_uart_dre_irq(uint8_t enable) {
+    if (enable) USART0.CTRLA |= USART_DREIE_bm;
+    else        USART0.CTRLA &= ~USART_DREIE_bm;
+}
+
+static inline void hal_uart_txc_clear(void) {
+    USART0.STATUS = USART_TXCIF_bm;
+}
+
+static inline uint8_t hal_uart_txc(void) {
+    return (USART0.STATUS & USART_TXCIF_bm) ? 1u : 0u;
+}
+
+// EEPROM: memory mapped reads, writes via the NVMCTRL page buffer
+#define HAL_EEPROM_SIZE EEPROM_SIZE
+#define HAL_EEPROM_PAGE EEPROM_PAGE_SIZE
+
+static inline const volatile uint8_t *hal_eeprom_ptr(uint8_t addr) {
+    return (const volatile uint8_t *)(MAPPED_EEPROM_START + addr);
+}
+
+static inline void hal_eeprom_buffer_write(uint8_t addr, uint8_t v) {
+    *(volatile uint8_t *)(MAPPED_EEPROM_START + addr) = v;
+}
+
+static inline void hal_eeprom_page_erase_write(void) {
+    ccp_write_spm((void *)&NVMCTRL.CTRLA, NVMCTRL_CMD_PAGEERASEWRITE_gc);
+}
+
+static inline uint8_t hal_eeprom_busy(void) {
+    return (NVMCTRL.STATUS & NVMCTRL_EEBUSY_bm) ? 1u : 0u;
+}
+
+#endif
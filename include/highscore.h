@@ -1,16 +1,38 @@
-// #ifndef HIGHSCORE_H
-// #define HIGHSCORE_H
+#ifndef HIGHSCORE_H
+#define HIGHSCORE_H
 
-// #include <stdint.h>
+#include <stdint.h>
 
-// /* Returns 1 if score would place in the top 5, 0 otherwise. */
-// uint8_t highscore_qualifies(uint16_t score);
+#define HS_MAX      5
+#define HS_NAME_MAX 20
 
-// /* Blocks while prompting & collecting name (max 20 chars) with 5 s rules.
-//    Inserts into table if it still qualifies (it will). */
-// void highscore_prompt_and_store(uint16_t score);
+/* Build with -DHS_PERSIST=1 to keep the table in EEPROM across resets.
+   Off by default: the assessment spec requires the table to be cleared on
+   reset. */
+#ifndef HS_PERSIST
+#define HS_PERSIST 0
+#endif
 
-// /* Prints each entry as "<name> <score>\n" in descending score order. */
-// void highscore_print_table(void);
+/* Returns 1 if score would place in the top 5, 0 otherwise. */
+uint8_t highscore_qualifies(uint16_t score);
 
-// #endif
+/* Inserts (name, score) in descending order, dropping the lowest entry
+   once the table is full. name is truncated to HS_NAME_MAX chars. */
+void highscore_insert(const char *name, uint16_t score);
+
+/* Length of "<name> <score>\n" for entry idx, 0 if idx is unused. Lets the
+   caller wait for TX ring space instead of blocking in uart_putc(). */
+uint8_t highscore_row_len(uint8_t idx);
+
+/* Transmits entry idx as "<name> <score>\n" (descending score order). */
+void highscore_print_row(uint8_t idx);
+
+/* Loads the newest valid EEPROM record, or leaves the table empty.
+   Call once at boot. No-op unless HS_PERSIST. */
+void highscore_load(void);
+
+/* Background EEPROM writer, call once per main loop iteration. Writes at
+   most one page per call and never waits on the NVM controller. */
+void highscore_service(void);
+
+#endif
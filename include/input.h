@@ -0,0 +1,51 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdint.h>
+
+/* Every gameplay input as one stream. The ISRs that see an input (TCB1 or
+   CCL for debounced button edges, USART0 RX for serial keys) push a
+   (source, button, edge, t) record into a FIFO, so the stream is in the
+   order the inputs happened and simultaneous button edges come out lowest
+   button first. The game loop drains it with input_get(). */
+
+typedef enum {
+    INPUT_SRC_PB,       // S1..S4, same numbering as TLM_SRC_*
+    INPUT_SRC_UART,     // gameplay keys, press only
+    INPUT_NUM_SOURCES
+} input_source_t;
+
+#define INPUT_PRESS     0
+#define INPUT_RELEASE   1
+
+typedef struct {
+    uint8_t source;
+    uint8_t button;     // 0..3
+    uint8_t edge;       // INPUT_PRESS / INPUT_RELEASE
+    uint16_t t;         // uptime_ms when it was seen
+} input_event_t;
+
+/* Queue one input; dropped (and counted) when the FIFO is full. Safe to
+   call from any context. */
+void input_push(uint8_t source, uint8_t button, uint8_t edge);
+
+/* Queue an edge for every bit in PA4..PA7 set in `changed`. `now` is the
+   new debounced level: a low bit is a press. Called from the debounce ISRs. */
+void input_pb_edges(uint8_t changed, uint8_t now);
+
+/* Oldest queued input into *e; 0 when the FIFO is empty */
+uint8_t input_get(input_event_t *e);
+
+/* Removes the oldest queued release of button S1..S4 `button`, wherever it
+   is in the FIFO, and returns 1; 0 if there is none. Inputs ahead of it
+   stay queued in order. Main loop only. */
+uint8_t input_take_release(uint8_t button);
+
+/* Inputs queued and dropped per source since boot, saturating */
+uint16_t input_count(uint8_t source, uint8_t edge);
+uint16_t input_dropped(uint8_t source);
+
+/* One line per source, for "!input" */
+void input_report(void);
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef IRQ_H
+#define IRQ_H
+
+#include <stdint.h>
+
+/* Interrupt levels. CPUINT lets one vector run at level 1, where it can
+   interrupt any level 0 ISR. TCB1 gets level 1 because late ticks show up
+   as display flicker and uneven debounce. All the other vectors stay at
+   level 0 with round robin (LVL0RR): the vector served last drops to the
+   lowest priority, so RXC during a burst, or DRE draining a long write,
+   cannot keep lower-numbered vectors waiting.
+
+   Worst entry latency each vector tolerates (CLK_PER 3.33 MHz):
+       TCB1_INT    100 us   level 1; display multiplex and debounce tick
+       TCB0_INT    1 ms     the next tick, or a millisecond is lost
+       SPI0_INT    5 ms     latch before TCB1 shifts out the next digit
+       USART0_RXC  1 char   1.04 ms at 9600 baud, 40 us at 250000
+       USART0_DRE  -        throughput only
+       PORTA_PORT  -        late entries only skew LATENCY/PB_SPECULATE
+       CCL_CCL     3.9 ms   one filter clock, before the next edge
+
+   TCB1 can now interrupt the other ISRs, so anything it shares with them
+   must be read and written atomically. input_push() and latency_mark()
+   already work that way, and the TCB0 tick updates its counters with
+   interrupts off. PROFILE's per-ISR cycle counts include any TCB1 run
+   nested inside them, and tools/isr_budget.py charges each level 0 ISR
+   one TCB1 run in cycles and stack. Build with -DIRQ_PRIORITY=0 to keep
+   every vector at level 0, in fixed priority order. */
+#ifndef IRQ_PRIORITY
+#define IRQ_PRIORITY 1
+#endif
+
+/* Build with -DIRQ_STATS=1 to measure how late each TCB1 ISR starts,
+   from TCB1's count at entry. "!irq" prints the number of ticks, the
+   worst latency in us and how many ticks missed IRQ_TCB1_BUDGET_US;
+   "!irq 0" clears them. "!irq flood <n>" is the stress mode: it writes n
+   filler bytes ('U') as fast as the TX ring takes them, so DRE fires once
+   per character. Run it at a high baud rate while the PC floods RX with
+   non-command bytes, then compare builds with and without IRQ_PRIORITY. */
+#ifndef IRQ_STATS
+#define IRQ_STATS 0
+#endif
+
+#define IRQ_TCB1_BUDGET_US 100
+
+void irq_init(void);                    // CPUINT levels, call before sei()
+
+#if IRQ_STATS
+
+void irq_tcb1_entry(void);              // first thing in TCB1_INT_vect
+
+/* Refills the TX ring while a flood is running. Call once per main loop
+   pass. */
+void irq_service(void);
+
+void irq_report(void);
+void irq_clear(void);
+void irq_flood(uint16_t n);
+
+#else
+
+#define irq_tcb1_entry()        ((void)0)
+#define irq_service()           ((void)0)
+
+#endif
+
+#endif
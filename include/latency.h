@@ -0,0 +1,54 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+
+/* Build with -DLATENCY=1 to measure press-to-output latency.
+   One press at a time is followed through these marks, each stamped with
+   uptime_ms and TCB0's count (one CLK_PER cycle resolution):
+       LAT_RAW        first falling edge on PA4..PA7 (pin-change ISR)
+       LAT_DEBOUNCED  the debouncer (TCB1 or CCL ISR) reports the press
+       LAT_INPUT      INPUT_WAITING sees it in the main loop
+       LAT_BUZZER     play_tone() writes TCA0 PER/CMP
+       LAT_SEGMENTS   set_display_segments() (gates the latch below)
+       LAT_LATCH      next SPI0 latch, i.e. the new segments are visible
+   A mark only counts if the previous one was seen, so bounces and presses
+   outside INPUT_WAITING are ignored. Each completed press adds to log2
+   histograms (in us) for debounce, loop, buzzer and display stages and the
+   raw-to-buzzer and raw-to-display totals. "!lat" prints them, "!lat 0"
+   clears them. With LATENCY 0 everything below compiles away. */
+#ifndef LATENCY
+#define LATENCY 0
+#endif
+
+typedef enum {
+    LAT_RAW,
+    LAT_DEBOUNCED,
+    LAT_INPUT,
+    LAT_BUZZER,
+    LAT_SEGMENTS,
+    LAT_LATCH,
+    LAT_NUM_MARKS
+} lat_mark_t;
+
+#if LATENCY
+
+void latency_init(void);                // enables the PA4..PA7 pin-change interrupt
+void latency_mark(uint8_t mark);        // safe from ISRs
+
+/* Bins a completed press, then prints one row of a pending report per
+   call once it fits in the TX ring. Call once per main loop pass. */
+void latency_service(void);
+
+void latency_report(void);
+void latency_clear(void);
+
+#else
+
+#define latency_init()          ((void)0)
+#define latency_mark(mark)      ((void)0)
+#define latency_service()       ((void)0)
+
+#endif
+
+#endif
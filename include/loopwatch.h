@@ -0,0 +1,48 @@
+#ifndef LOOPWATCH_H
+#define LOOPWATCH_H
+
+#include <stdint.h>
+
+/* Build with -DLOOPWATCH=1 to catch main loop stalls.
+   Every pass beats loopwatch_beat() with the current Game_State, which
+   times the pass since the last beat (TCB0, one cycle resolution) into a
+   log2 histogram and keeps the longest pass and the state it ran in.
+   The 1 ms tick checks the heartbeat: a loop that has not beaten for
+   LOOPWATCH_STALL_MS counts as a stall, and while it lasts its state and
+   length are kept in .noinit SRAM. The beat also clears the watchdog, so
+   a loop stuck for LOOPWATCH_WDT_MS resets the chip; the next boot finds
+   the watchdog reset flag and reports the offending state. "!loop" prints
+   the longest pass, the stall count, any watchdog reset and the non-empty
+   histogram bins, one row per main loop pass; "!loop 0" clears them. With
+   LOOPWATCH 0 nothing is built and the watchdog stays off. */
+#ifndef LOOPWATCH
+#define LOOPWATCH 0
+#endif
+
+#define LOOPWATCH_STALL_MS  50      // blocking output at 9600 baud stays under this
+#define LOOPWATCH_WDT_MS    256     // hard limit, rounded to a watchdog period
+
+#if LOOPWATCH
+
+/* Call before sei() with the boot's reset flags (hal_reset_flags()) */
+void loopwatch_init(uint8_t reset_flags);
+
+void loopwatch_beat(uint8_t state);     // once per main loop pass
+void loopwatch_tick(void);              // from the 1 ms TCB0 ISR
+
+/* Prints one row of a pending report per call once it fits in the TX ring */
+void loopwatch_service(void);
+
+void loopwatch_report(void);
+void loopwatch_clear(void);
+
+#else
+
+#define loopwatch_init(reset_flags)     ((void)(reset_flags))
+#define loopwatch_beat(state)           ((void)0)
+#define loopwatch_tick()                ((void)0)
+#define loopwatch_service()             ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef NVM_H
+#define NVM_H
+
+#include <stdint.h>
+#include "hal.h"
+
+/* ATtiny1626 EEPROM: 256 bytes, 32-byte pages, memory mapped for reads.
+   Writes go through the NVMCTRL page buffer and take ~4 ms (erase + write)
+   during which the CPU keeps running; poll nvm_eeprom_busy() first. */
+#define NVM_EEPROM_SIZE HAL_EEPROM_SIZE
+#define NVM_EEPROM_PAGE HAL_EEPROM_PAGE
+
+static inline uint8_t nvm_eeprom_busy(void) {
+    return hal_eeprom_busy();
+}
+
+static inline const volatile uint8_t *nvm_eeprom_ptr(uint8_t addr) {
+    return hal_eeprom_ptr(addr);
+}
+
+/* Loads one page into the page buffer and starts an erase/write.
+   addr must be page aligned. Returns immediately. */
+void nvm_eeprom_write_page(uint8_t addr, const uint8_t *data);
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include "game.h"
+
+/* Build with -DPROFILE=1 to measure where the CPU time goes.
+   ISRs are timed with TCB0's free-running count (1 cycle resolution, valid
+   while an ISR takes under 1 ms) and keep min/avg/max cycles per vector.
+   The main loop reports its Game_State on every pass, giving per-state
+   entry counts, dwell times and loop rates. "!stats" prints both tables,
+   "!stats 0" clears them. With PROFILE 0 the macros below expand to
+   nothing and the command does not exist. */
+#ifndef PROFILE
+#define PROFILE 0
+#endif
+
+typedef enum {
+    PROF_TCB0,
+    PROF_TCB1,
+    PROF_SPI0,
+    PROF_RXC,
+    PROF_DRE,
+    PROF_CCL,               // PB_HW_DEBOUNCE only
+    PROF_NUM_ISR
+} prof_isr_t;
+
+#define PROF_NUM_STATES GAME_NUM_STATES     // Game_State in game.h
+
+#if PROFILE
+
+#include "hal.h"
+
+void profile_isr_exit(uint8_t isr, uint16_t start);
+
+/* Call on every main loop pass with the current Game_State */
+void profile_loop(uint8_t state);
+
+/* Start a report ("!stats") or clear the counters ("!stats 0") */
+void profile_report(void);
+void profile_clear(void);
+
+/* Prints one row of a pending report per call once it fits in the TX ring */
+void profile_service(void);
+
+#define PROFILE_ISR_ENTER()     uint16_t prof_start_ = hal_tcb_count(0)
+#define PROFILE_ISR_EXIT(isr)   profile_isr_exit((isr), prof_start_)
+
+#else
+
+#define PROFILE_ISR_ENTER()
+#define PROFILE_ISR_EXIT(isr)
+#define profile_loop(state)
+#define profile_service()
+
+#endif
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef STACKMON_H
+#define STACKMON_H
+
+#include <stdint.h>
+
+/* Build with -DSTACKMON=1 to watch the gap between the end of static RAM
+   (.data/.bss, linker symbol _end) and the stack. Before .data/.bss are set
+   up, code in .init1 paints that whole gap with STACK_CANARY. Every main
+   loop pass stackmon_service() extends the high-water mark downwards past
+   any bytes that are no longer paint, which catches ISR stack use too.
+   "!stack" reports the .data and .bss sizes, the current free gap and the
+   smallest gap seen. AVR build only; with STACKMON 0 nothing is built. */
+#ifndef STACKMON
+#define STACKMON 0
+#endif
+
+#define STACK_CANARY 0xC5
+
+#if STACKMON
+
+void stackmon_service(void);
+
+/* Prints the report with uart_putc(), two short lines */
+void stackmon_report(void);
+
+#else
+
+#define stackmon_service()  ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+
+/* Binary game-event stream over UART.
+   Each event is a fixed 6-byte record
+       type:u8  value:u16le  t_ms:u16le  crc8:u8
+   COBS encoded and terminated by 0x00 (8 bytes on the wire). t_ms is the
+   low 16 bits of uptime_ms. tools/telemetry_decode.py turns a capture into
+   CSV. Off at boot; toggled with "!tlm 1" / "!tlm 0". */
+
+typedef enum {
+    TLM_STEP = 1,       // value: step played (0..3)
+    TLM_INPUT,          // value: (source << 8) | button, source 0 = pushbutton, 1 = UART
+    TLM_SUCCESS,        // value: score
+    TLM_FAIL,           // value: score
+    TLM_OCTAVE,         // value: new octave (int8_t)
+    TLM_DELAY           // value: playback delay in ms
+} tlm_event_t;
+
+#define TLM_SRC_PB   0
+#define TLM_SRC_UART 1
+
+extern volatile uint8_t telemetry_enabled;
+
+/* Queue one event without blocking; dropped (and counted) if the TX ring is
+   full. Safe to call from ISRs. */
+void telemetry_emit_event(uint8_t type, uint16_t value);
+
+/* Cheap guard so disabled telemetry costs a single load and branch */
+static inline void telemetry_emit(uint8_t type, uint16_t value) {
+    if (telemetry_enabled) telemetry_emit_event(type, value);
+}
+
+uint16_t telemetry_dropped(void);
+
+/* Longest record telemetry_send() frames, CRC included */
+#define TLM_RECORD_MAX 10
+
+/* Frames any record the same way: rec[0..n-1] plus a CRC-8 written to
+   rec[n], COBS encoded and queued without blocking. Returns 0 (queueing
+   nothing) if the TX ring is too full. Types 0x80 and up are tlog.h
+   records. */
+uint8_t telemetry_send(uint8_t *rec, uint8_t n);
+
+#endif
@@ -2,9 +2,18 @@
 #define TIMER_H
 
 #include <stdint.h>
+#include "board_config.h"       // TIMER_CCMP
 
 extern volatile uint16_t elapsed_time;
+extern volatile uint16_t uptime_ms;
 
 void timer_init(void);
 
+/* CLK_PER cycles since uptime_ms last wrapped, from uptime_ms and TCB0's
+   count; wraps at TIMER_WRAP. Call with interrupts off. */
+#define TIMER_WRAP (65536UL * (TIMER_CCMP + 1))
+uint32_t timer_cycles(void);
+uint32_t timer_span(uint32_t from, uint32_t to);   // to - from across one wrap
+uint16_t timer_us(uint32_t cycles);                 // saturates at 65535
+
 #endif
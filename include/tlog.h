@@ -0,0 +1,56 @@
+#ifndef TLOG_H
+#define TLOG_H
+
+#include <stdint.h>
+
+/* Build with -DTLOG=1 for tokenized debug logging, cheap enough for ISRs
+   and the timed game states. A log site
+
+       TLOG2("state %u -> %u", from, to);
+
+   compiles to a 16-bit token for its format string and up to two 16-bit
+   arguments, pushed into a RAM ring with interrupts off. The format
+   strings themselves sit in the .tlog section of the ELF, which is never
+   loaded (tools/tlog.ld), so they cost no flash. tlog_service() sends one
+   record per pass as a telemetry frame (telemetry.h)
+       type:u8  token:u16le  t_ms:u16le  args:u16le...  crc8:u8
+   with type 0x80 + number of args, when "!log 1" has turned the stream on
+   and the TX ring has room. tools/tlog_decode.py reads the strings back
+   out of the ELF and prints each record as text. Records that find the
+   ring full are counted; "!log" prints the count. With TLOG 0 the sites
+   compile away and their arguments are not evaluated. */
+#ifndef TLOG
+#define TLOG 0
+#endif
+
+#define TLOG_TYPE 0x80
+
+#if TLOG
+
+extern volatile uint8_t tlog_enabled;
+
+/* Queues one record; safe from any context */
+void tlog_push(uint16_t token, uint8_t nargs, uint16_t a, uint16_t b);
+
+/* Sends the oldest queued record. Call once per main loop pass. */
+void tlog_service(void);
+
+uint16_t tlog_dropped(void);
+
+#define TLOG0(fmt) \
+    do { if (tlog_enabled) tlog_push(TLOG_TOKEN(fmt), 0, 0, 0); } while (0)
+#define TLOG1(fmt, a) \
+    do { if (tlog_enabled) tlog_push(TLOG_TOKEN(fmt), 1, (uint16_t)(a), 0); } while (0)
+#define TLOG2(fmt, a, b) \
+    do { if (tlog_enabled) tlog_push(TLOG_TOKEN(fmt), 2, (uint16_t)(a), (uint16_t)(b)); } while (0)
+
+#else
+
+#define tlog_service()      ((void)0)
+#define TLOG0(fmt)          ((void)0)
+#define TLOG1(fmt, a)       ((void)0)
+#define TLOG2(fmt, a, b)    ((void)0)
+
+#endif
+
+#endif
@@ -2,16 +2,91 @@
 #define UART_H
 
 #include <stdint.h>
+#include "hal.h"
 
-void uart_init();                    // Initialise UART as stdin/stdout
+void uart_init();                    // Initialise USART0 for 9600 8N1
+
+// Baud rate engine
+// BAUD register values derived from F_CPU at compile time. Normal mode
+// oversamples 16x (BAUD = 64 * F_CPU / (16 * rate)), CLK2X oversamples 8x
+// (BAUD = 64 * F_CPU / (8 * rate)). The register must be >= 64, so CLK2X is
+// only used once the normal-mode value would fall below that.
+#define UART_BAUD_NORMAL(rate)  ((uint16_t)((4UL * F_CPU + (rate) / 2) / (rate)))
+#define UART_BAUD_CLK2X(rate)   ((uint16_t)((8UL * F_CPU + (rate) / 2) / (rate)))
+#define UART_USE_CLK2X(rate)    ((4UL * F_CPU + (rate) / 2) / (rate) < 64)
+#define UART_BAUD_REG(rate)     (UART_USE_CLK2X(rate) ? UART_BAUD_CLK2X(rate) : UART_BAUD_NORMAL(rate))
+#define UART_RATE_OK(rate)      (((UART_USE_CLK2X(rate) ? 8UL : 4UL) * F_CPU + (rate) / 2) / (rate) >= 64)
+
+#define UART_DEFAULT_BAUD 9600UL      // spec-mandated boot rate
+
+// Queue a switch to `rate`. Returns 0 if the rate is not in the table or not
+// reachable at F_CPU. Otherwise writes `ack` (a flash string) at the old
+// rate, and uart_service() applies the switch once it has left the shifter.
+uint8_t uart_request_baud(uint32_t rate, const char *ack);
+uint32_t uart_current_baud(void);
+
+// Call once per main loop iteration
+void uart_service(void);
+
+// '!'-prefixed command lines, e.g. "!baud 115200\n". Returns the line
+// (without '!' and newline) once complete, otherwise 0. Call
+// uart_cmd_release() when done with it. A '!' with no newline within 15
+// bytes, or with a 1 s gap, is dropped and the bytes after it are handled
+// as keys.
+const char *uart_cmd_line(void);
+void uart_cmd_release(void);
 
 uint8_t uart_getc (void);
+
+// Output goes through a 32-byte ring drained by the DRE interrupt.
+// uart_putc() waits only while the ring is full, so it must not be called
+// from an ISR. uart_write_nb() never waits: it queues all n bytes or none
+// and returns 0, and is safe from any context.
 void uart_putc(uint8_t c);
+uint8_t uart_write_nb(const uint8_t *buf, uint8_t n);
+uint8_t uart_tx_free(void);
+
+// printf-free output helpers. All of them feed uart_putc() directly, so no
+// stdio/vfprintf code is linked in. Cycle counts are estimates from the C
+// source (CLK_PER, -Os), not measured on the AVR, and cover the formatting
+// work only, i.e. they exclude any time uart_putc() spends waiting for
+// ring space (~1.04 ms per byte at 9600 baud).
 
-// Global volatile variable for UART game input (set by ISR)
-extern volatile int8_t uart_game_input;
+// Flash-resident string, e.g. uart_put_str_P(PSTR("SUCCESS\n")).
+// ~9 cycles per character (estimate).
+void uart_put_str_P(const char *s);
 
-// Simple flag: only accept game input during user input phase
+// Unsigned decimal 0..65535 without leading zeroes. Uses repeated
+// subtraction of powers of ten (no division routine), worst case ~230
+// cycles for 59999 (estimate).
+void uart_put_u16(uint16_t v);
+
+// Eight upper-case hex digits, zero padded. ~110 cycles (estimate).
+void uart_put_hex32(uint32_t v);
+
+// Flash-resident label followed by v in decimal, e.g.
+// uart_put_field_P(PSTR(" max_us "), us).
+void uart_put_field_P(const char *label, uint16_t v);
+
+// Long reports go out one row per main loop pass, and a row is only started
+// once the TX ring can take the longest one (max_len bytes) whole, so the
+// main loop never waits on the UART. *next is the report's next row, set to
+// 0 to start it and UART_ROW_NONE while idle. Returns the row to print on
+// this pass, or UART_ROW_NONE, and sets *next back to UART_ROW_NONE once
+// the last of `rows` rows has been handed out.
+#define UART_ROW_NONE 0xFF
+uint8_t uart_report_row(uint8_t *next, uint8_t rows, uint8_t max_len);
+
+// Name entry: while enabled, every received byte is queued for
+// uart_name_getc() and bypasses game keys, octave keys and commands.
+void uart_name_entry(uint8_t enable);
+int16_t uart_name_getc(void);        // -1 when nothing is queued
+
+// Simple flag: only accept game input during user input phase. Accepted
+// keys go to the input stream (input.h)
 extern volatile uint8_t uart_input_enabled;
 
+// Set by '0' / 'p' (RESET), cleared by the game loop
+extern volatile uint8_t uart_reset_request;
+
 #endif
@@ -1,15 +1,50 @@
-#include <avr/io.h>
-#include <avr/interrupt.h>
-
+#include "hal.h"
 #include "buttons.h"
+#include "profile.h"
+#include "latency.h"
+#include "input.h"
+#include "irq.h"
 
 volatile uint8_t pb_debounced = 0xFF;
+volatile uint8_t pb_raw_falling = 0;
+
+#if LATENCY || PB_SPECULATE
+// Falling edges on released buttons only: contact bounce on release
+// happens while the button still reads as pressed after debouncing
+ISR(PORTA_PORT_vect)
+{
+    uint8_t pb_falling = hal_buttons_irq_ack() & pb_debounced;
+    if (pb_falling) {
+        pb_raw_falling |= pb_falling;
+        latency_mark(LAT_RAW);
+    }
+}
+#endif
+
+#if PB_HW_DEBOUNCE
+// Filtered edge on PA4..PA7. The filter only passes a level the pin has
+// held for two filter clocks, so each flagged bit is re-read from the pin
+// rather than flipped: a missed or merged edge cannot leave it inverted,
+// and flags that land back on the same level report nothing
+ISR(CCL_CCL_vect)
+{
+    PROFILE_ISR_ENTER();
 
+    uint8_t pb_edges = hal_buttons_filter_ack();
+    uint8_t pb_now = (pb_debounced & ~pb_edges) | (hal_buttons_read() & pb_edges);
+    uint8_t pb_toggled = pb_now ^ pb_debounced;
+    pb_debounced = pb_now;
+    if (pb_toggled) input_pb_edges(pb_toggled, pb_debounced);
+
+    if (pb_toggled & ~pb_debounced) latency_mark(LAT_DEBOUNCED);
+    PROFILE_ISR_EXIT(PROF_CCL);
+}
+#else
 void pb_debounce(void) {
     static uint8_t vcount1 = 0;      //vertical counter MSB
     static uint8_t vcount0 = 0;      //vertical counter LSB
      
-    uint8_t pb_sample = PORTA.IN;
+    uint8_t pb_sample = hal_buttons_read();
 
     uint8_t pb_changed = pb_sample ^ pb_debounced;
 
@@ -17,44 +52,50 @@ void pb_debounce(void) {
     vcount1 = (vcount1 ^ vcount0) & pb_changed;  //update MSB of vertical counter
     vcount0 = ~vcount0 & pb_changed;             //update LSB of vertical counter
 
-    pb_debounced ^= (vcount0 & vcount1);         //update debounced when vertial counter = 11
+    uint8_t pb_toggled = vcount0 & vcount1;
+    pb_debounced ^= pb_toggled;                  //update debounced when vertial counter = 11
+    if (pb_toggled) input_pb_edges(pb_toggled, pb_debounced);
+
+    if (pb_toggled & ~pb_debounced & 0xF0) latency_mark(LAT_DEBOUNCED);
 }//pb_debounce
+#endif
 
 void pb_init(void) {
-    // already configured as inputs by default
-
-    // enable internal pullup resistors
-    PORTA.PIN4CTRL = PORT_PULLUPEN_bm;
-    PORTA.PIN5CTRL = PORT_PULLUPEN_bm;
-    PORTA.PIN6CTRL = PORT_PULLUPEN_bm;
-    PORTA.PIN7CTRL = PORT_PULLUPEN_bm;            
+    // inputs with internal pullup resistors
+    hal_buttons_init();
 }//pb_init
 
 // Wrapper for compatibility
 void buttons_init(void) {
     pb_init();
+#if PB_HW_DEBOUNCE
+    hal_buttons_filter_init();
+#endif
+#if PB_SPECULATE
+    hal_buttons_irq_init();
+#endif
     
     // Setup TCB1 for 5ms periodic interrupt (display multiplex + button debounce)
-    TCB1.CTRLA   = 0;
-    TCB1.CNT     = 0;
-    TCB1.CCMP    = 16667;  // 3.3 MHz / 16667 = ~5ms
-    TCB1.CTRLB   = TCB_CNTMODE_INT_gc;
-    TCB1.INTFLAGS = TCB_CAPT_bm;
-    TCB1.INTCTRL  = TCB_CAPT_bm;
-    TCB1.CTRLA   = TCB_ENABLE_bm;
+    hal_tcb_init_periodic(1, BUTTONS_CCMP, BUTTONS_TCB_DIV2);
 }
 
 // TCB1 ISR: Called every 5ms for display multiplexing and button debouncing
 ISR(TCB1_INT_vect)
 {
+    irq_tcb1_entry();
+    PROFILE_ISR_ENTER();
+
     // Multiplex display
     extern void swap_display_digit(void);
     swap_display_digit();
     
+#if !PB_HW_DEBOUNCE
     // Debounce buttons
     pb_debounce();
+#endif
 
-    TCB1.INTFLAGS = TCB_CAPT_bm;
+    hal_tcb_ack(1);
+    PROFILE_ISR_EXIT(PROF_TCB1);
 }
 
 
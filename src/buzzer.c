@@ -1,59 +1,75 @@
-#include <avr/io.h>
+#include "hal.h"
 #include "buzzer.h"
+#include "latency.h"
 
-// Octave shifting for Section D
-static int8_t octave = 0;
+// Default tones (Table 2, xy = 40), Hz
+#define TONE_E_HIGH_HZ  330UL
+#define TONE_C_SHARP_HZ 277UL
+#define TONE_A_HZ       440UL
+#define TONE_E_LOW_HZ   165UL
+
+// Octave shifting for Section D. The UART RX ISR changes it while a tone
+// may be sounding, so the tone in TCA0 is retuned on the spot.
+static volatile int8_t octave = 0;
 #define MAX_OCTAVE 3
 #define MIN_OCTAVE -3
+#define NUM_OCTAVES (MAX_OCTAVE - MIN_OCTAVE + 1)
+
+// Tone in TCA0 right now, or TONE_NONE when muted or sounding a raw Hz
+#define TONE_NONE 0xFF
+static volatile uint8_t active_tone = TONE_NONE;
+
+// Period of a tone `oct` octaves up, clamped to 20 kHz and to the 16-bit
+// PER register
+#define TONE_SHIFT(hz, oct)  ((oct) >= 0 ? BUZZER_PERIOD(hz) >> (oct) : BUZZER_PERIOD(hz) << -(oct))
+#define TONE_CLAMP(p)        ((p) < BUZZER_PERIOD_MIN ? BUZZER_PERIOD_MIN : \
+                              (p) > BUZZER_PERIOD_MAX ? BUZZER_PERIOD_MAX : (p))
+#define TONE_PER(hz, oct)    ((uint16_t)(TONE_CLAMP(TONE_SHIFT(hz, oct)) - 1))
+#define TONE_ROW(hz)         { TONE_PER(hz, -3), TONE_PER(hz, -2), TONE_PER(hz, -1), TONE_PER(hz, 0), \
+                               TONE_PER(hz, 1), TONE_PER(hz, 2), TONE_PER(hz, 3) }
+
+// TCA0 PER of every tone (330, 277, 440, 165 Hz) at every octave, folded
+// at compile time so a retune from the RX ISR is one lookup
+static const uint16_t tone_per[4][NUM_OCTAVES] PROGMEM = {
+    TONE_ROW(TONE_E_HIGH_HZ), TONE_ROW(TONE_C_SHARP_HZ),
+    TONE_ROW(TONE_A_HZ), TONE_ROW(TONE_E_LOW_HZ)
+};
+_Static_assert(BUZZER_PERIOD(TONE_E_LOW_HZ) < BUZZER_PERIOD_MAX, "lowest tone overflows TCA0 PER at F_CPU");
+_Static_assert(BUZZER_PERIOD(TONE_A_HZ) >= BUZZER_PERIOD_MIN, "highest tone above 20 kHz");
 
 void buzzer_init(void) {
 
-    // TCA0 will control the buzzer (PB0), so we need to enable it as an output
-    PORTB.OUTCLR = PIN0_bm; // buzzer off initially
-    PORTB.DIRSET = PIN0_bm; // Enable PB0 as output
-
-    TCA0.SINGLE.CTRLA = TCA_SINGLE_CLKSEL_DIV2_gc;   //prescaler = 2 (gives 1.666 MHz)
-
-    // Single-slope PWM mode, WO0 enable (PB0, BUZZER)    
-    TCA0.SINGLE.CTRLB = TCA_SINGLE_WGMODE_SINGLESLOPE_gc | TCA_SINGLE_CMP0EN_bm;
-
-    // PWM initially off
-    TCA0.SINGLE.PER = 1;      
-    TCA0.SINGLE.CMP0 = 0;    
-
-    TCA0.SINGLE.CTRLA |= TCA_SINGLE_ENABLE_bm;      // Enable TCA0 
+    // TCA0 drives the buzzer (PB0): single-slope PWM at BUZZER_CLK_HZ,
+    // initially off
+    hal_buzzer_init();
 }//buzzer_init
 
 
+// Loads PERBUF/CMP0BUF for `tone` at the current octave; TCA0 switches
+// over at its next UPDATE, so within one period of the old tone. Callers
+// hold interrupts off: both registers go through TCA0's shared TEMP byte
+// and the octave must not change in between.
+static void tone_load(uint8_t tone)
+{
+    uint16_t per = pgm_read_word(&tone_per[tone][octave - MIN_OCTAVE]);
+    hal_buzzer_set(per, (uint16_t)((per + 1UL) >> 1));
+}
+
 void play_tone(uint8_t tone)
 {
-    // Base PER values (using DIV2 prescaler -> 1,666,666 Hz):
-    // corresponding to tones: 330, 277, 440, 165 Hz
-    static const uint32_t base_per_values32[4] = {5050UL, 6012UL, 3788UL, 10101UL};
-
-    // Use 32-bit intermediate to avoid overflow/truncation when shifting
-    uint32_t per32 = base_per_values32[tone];
-
-    // Apply octave shift using 32-bit arithmetic
-    if (octave > 0) {
-        per32 >>= octave;  // Higher frequency => smaller PER
-    } else if (octave < 0) {
-        per32 <<= (uint8_t)(-octave);  // Lower frequency => larger PER
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        active_tone = tone;
+        tone_load(tone);
     }
-
-    // Clamp to hardware / audible limits. PER must fit in 16-bit TCA register.
-    // At 1.666 MHz: 20 kHz -> PER ~= 83, 20 Hz -> PER ~= 83333 (too large for 16-bit)
-    if (per32 < 83UL) per32 = 83UL;
-    if (per32 > 0xFFFFUL) per32 = 0xFFFFUL;
-
-    uint16_t per16 = (uint16_t)per32;
-    TCA0.SINGLE.PERBUF = per16;
-    TCA0.SINGLE.CMP0BUF = per16 >> 1;
+    latency_mark(LAT_BUZZER);
 }//play_tone
 
 void stop_tone(void)
 {
-    TCA0.SINGLE.CMP0BUF = 0;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        active_tone = TONE_NONE;
+        hal_buzzer_mute();
+    }
 }//stop_tone
 
 // Wrapper functions for Simon Says
@@ -67,24 +83,47 @@ void buzzer_stop(void) {
 
 void buzzer_start_hz(uint16_t hz) {
     if (hz == 0) {
-        TCA0.SINGLE.CMP0BUF = 0;
+        stop_tone();
         return;
     }
-    // Using DIV2 prescaler, effective clock = 1.666 MHz
-    uint32_t per = (1666666UL + (hz >> 1)) / hz;
+    uint32_t per = BUZZER_PERIOD((uint32_t)hz);
     if (per == 0) per = 1;
     per -= 1;
     if (per > 0xFFFF) per = 0xFFFF;
     
-    TCA0.SINGLE.PERBUF = (uint16_t)per;
-    TCA0.SINGLE.CMP0BUF = (uint16_t)((per + 1) >> 1);
+    // Raw frequencies are not octave shifted, so not retuned either
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        active_tone = TONE_NONE;
+        hal_buzzer_set((uint16_t)per, (uint16_t)((per + 1) >> 1));
+    }
+}
+
+// Sets the octave and retunes a sounding Simon tone; interrupts off
+static void octave_set(int8_t o)
+{
+    if (o < MIN_OCTAVE || o > MAX_OCTAVE) return;
+    octave = o;
+    if (active_tone != TONE_NONE) tone_load(active_tone);
 }
 
 void increase_octave(void) {
-    if (octave < MAX_OCTAVE) octave++;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        octave_set(octave + 1);
+    }
 }
 
 void decrease_octave(void) {
-    if (octave > MIN_OCTAVE) octave--;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        octave_set(octave - 1);
+    }
 }
 
+void reset_octave(void) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        octave_set(0);
+    }
+}
+
+int8_t buzzer_get_octave(void) {
+    return octave;
+}
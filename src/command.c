@@ -0,0 +1,282 @@
+#include <stdint.h>
+#include <string.h>
+#include "hal.h"
+
+#include "command.h"
+#include "uart.h"
+#include "telemetry.h"
+#include "profile.h"
+#include "latency.h"
+#include "stackmon.h"
+#include "input.h"
+#include "buttons.h"
+#include "game.h"
+#include "irq.h"
+#include "tlog.h"
+#include "flightrec.h"
+#include "loopwatch.h"
+
+typedef void (*command_handler_t)(const char *arg);
+
+typedef struct {
+    const char *name;               // PGM string
+    command_handler_t handler;
+} command_t;
+
+static void cmd_baud(const char *arg);
+static void cmd_tlm(const char *arg);
+static void cmd_input(const char *arg);
+#if PROFILE
+static void cmd_stats(const char *arg);
+#endif
+#if LATENCY
+static void cmd_lat(const char *arg);
+#endif
+#if STACKMON
+static void cmd_stack(const char *arg);
+#endif
+#if PB_SPECULATE
+static void cmd_spec(const char *arg);
+#endif
+#if IRQ_STATS
+static void cmd_irq(const char *arg);
+#endif
+#if TLOG
+static void cmd_log(const char *arg);
+#endif
+#if FLIGHTREC
+static void cmd_fr(const char *arg);
+#endif
+#if LOOPWATCH
+static void cmd_loop(const char *arg);
+#endif
+
+static const char name_baud[] PROGMEM = "baud";
+static const char name_tlm[]  PROGMEM = "tlm";
+static const char name_input[] PROGMEM = "input";
+#if PROFILE
+static const char name_stats[] PROGMEM = "stats";
+#endif
+#if LATENCY
+static const char name_lat[] PROGMEM = "lat";
+#endif
+#if STACKMON
+static const char name_stack[] PROGMEM = "stack";
+#endif
+#if PB_SPECULATE
+static const char name_spec[] PROGMEM = "spec";
+#endif
+#if IRQ_STATS
+static const char name_irq[] PROGMEM = "irq";
+#endif
+#if TLOG
+static const char name_log[] PROGMEM = "log";
+#endif
+#if FLIGHTREC
+static const char name_fr[] PROGMEM = "fr";
+#endif
+#if LOOPWATCH
+static const char name_loop[] PROGMEM = "loop";
+#endif
+
+static const command_t commands[] PROGMEM = {
+    { name_baud, cmd_baud },
+    { name_tlm,  cmd_tlm },
+    { name_input, cmd_input },
+#if PROFILE
+    { name_stats, cmd_stats },
+#endif
+#if LATENCY
+    { name_lat, cmd_lat },
+#endif
+#if STACKMON
+    { name_stack, cmd_stack },
+#endif
+#if PB_SPECULATE
+    { name_spec, cmd_spec },
+#endif
+#if IRQ_STATS
+    { name_irq, cmd_irq },
+#endif
+#if TLOG
+    { name_log, cmd_log },
+#endif
+#if FLIGHTREC
+    { name_fr, cmd_fr },
+#endif
+#if LOOPWATCH
+    { name_loop, cmd_loop },
+#endif
+};
+#define NUM_COMMANDS (sizeof(commands) / sizeof(commands[0]))
+
+uint32_t command_parse_u32(const char *s)
+{
+    uint32_t v = 0;
+    if (!*s) return 0;
+    while (*s) {
+        if (*s < '0' || *s > '9') return 0;
+        v = v * 10 + (uint8_t)(*s++ - '0');
+    }
+    return v;
+}
+
+// "!baud"          -> reports current rate
+// "!baud <rate>"   -> "OK\n" at the old rate, then switches; "ERR\n" if unsupported
+static void cmd_baud(const char *arg)
+{
+    if (!*arg) {
+        // All table rates are multiples of 100, which keeps this within uart_put_u16
+        uart_put_u16((uint16_t)(uart_current_baud() / 100));
+        uart_put_str_P(PSTR("00\n"));
+        return;
+    }
+    if (!uart_request_baud(command_parse_u32(arg), PSTR("OK\n"))) {
+        uart_put_str_P(PSTR("ERR\n"));
+    }
+}
+
+// "!tlm 1" / "!tlm 0" -> enable/disable the binary event stream
+// "!tlm"               -> number of events dropped on a full TX ring
+static void cmd_tlm(const char *arg)
+{
+    if (*arg == '1') {
+        telemetry_enabled = 1;
+    } else if (*arg == '0') {
+        telemetry_enabled = 0;
+    } else {
+        uart_put_u16(telemetry_dropped());
+        uart_putc('\n');
+    }
+}
+
+// "!input" -> queued and dropped inputs per source
+static void cmd_input(const char *arg)
+{
+    (void)arg;
+    input_report();
+}
+
+#if PROFILE
+// "!stats"   -> ISR cycles and per-state dwell/loop rate tables (see profile.h)
+// "!stats 0" -> clear the counters
+static void cmd_stats(const char *arg)
+{
+    if (*arg == '0') {
+        profile_clear();
+    } else {
+        profile_report();
+    }
+}
+#endif
+
+#if LATENCY
+// "!lat"   -> press-to-output latency histograms (see latency.h)
+// "!lat 0" -> clear them
+static void cmd_lat(const char *arg)
+{
+    if (*arg == '0') {
+        latency_clear();
+    } else {
+        latency_report();
+    }
+}
+#endif
+
+#if STACKMON
+// "!stack" -> static RAM sizes, current and minimum free stack gap
+static void cmd_stack(const char *arg)
+{
+    (void)arg;
+    stackmon_report();
+}
+#endif
+
+#if PB_SPECULATE
+// "!spec" -> speculative echoes started, confirmed and rolled back
+static void cmd_spec(const char *arg)
+{
+    (void)arg;
+    game_spec_report();
+}
+#endif
+
+#if IRQ_STATS
+// "!irq"           -> TCB1 entry latency (see irq.h)
+// "!irq 0"         -> clear it
+// "!irq flood <n>" -> n filler bytes out of the UART as fast as it goes
+static void cmd_irq(const char *arg)
+{
+    if (strncmp_P(arg, PSTR("flood "), 6) == 0) {
+        irq_flood((uint16_t)command_parse_u32(arg + 6));
+    } else if (*arg == '0') {
+        irq_clear();
+    } else {
+        irq_report();
+    }
+}
+#endif
+
+#if TLOG
+// "!log 1" / "!log 0" -> start/stop the tokenized log stream (see tlog.h)
+// "!log"               -> number of records dropped on a full ring
+static void cmd_log(const char *arg)
+{
+    if (*arg == '1') {
+        tlog_enabled = 1;
+    } else if (*arg == '0') {
+        tlog_enabled = 0;
+    } else {
+        uart_put_u16(tlog_dropped());
+        uart_putc('\n');
+    }
+}
+#endif
+
+#if FLIGHTREC
+// "!fr"   -> flight recorder, oldest record first (see flightrec.h)
+// "!fr 0" -> empty it
+static void cmd_fr(const char *arg)
+{
+    if (*arg == '0') {
+        flightrec_clear();
+    } else {
+        flightrec_dump();
+    }
+}
+#endif
+
+#if LOOPWATCH
+// "!loop"   -> longest main loop pass, stalls and pass histogram (see loopwatch.h)
+// "!loop 0" -> clear them
+static void cmd_loop(const char *arg)
+{
+    if (*arg == '0') {
+        loopwatch_clear();
+    } else {
+        loopwatch_report();
+    }
+}
+#endif
+
+void command_service(void)
+{
+    const char *line = uart_cmd_line();
+    if (!line) return;
+
+    // Split "<name> <arg>"
+    const char *arg = line;
+    while (*arg && *arg != ' ') arg++;
+    uint8_t name_len = (uint8_t)(arg - line);
+    if (*arg == ' ') arg++;
+
+    for (uint8_t k = 0; k < NUM_COMMANDS; k++) {
+        const char *name = (const char *)pgm_read_ptr(&commands[k].name);
+        if (strlen_P(name) == name_len && strncmp_P(line, name, name_len) == 0) {
+            command_handler_t handler = (command_handler_t)pgm_read_ptr(&commands[k].handler);
+            handler(arg);
+            break;
+        }
+    }
+    uart_cmd_release();
+}
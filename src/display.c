@@ -1,9 +1,8 @@
-
-#include <avr/io.h>
-#include <avr/interrupt.h>
-
+#include "hal.h"
 #include "display.h"
 #include "display_macros.h"
+#include "profile.h"
+#include "latency.h"
 
 volatile uint8_t digit_l = SEGS_OFF;
 volatile uint8_t digit_r = SEGS_OFF;
@@ -34,19 +33,8 @@ const uint8_t left_patterns[4] = {DISP_BAR_LEFT, DISP_BAR_RIGHT, DISP_OFF, DISP_
 const uint8_t right_patterns[4] = {DISP_OFF, DISP_OFF, DISP_BAR_LEFT, DISP_BAR_RIGHT};
 
 void display_init(void) {
-    PORTMUX.SPIROUTEA = PORTMUX_SPI0_ALT1_gc;  // SPI pins on PC0-3
-
-    // SPI SCK and MOSI
-    PORTC.DIRSET = (PIN0_bm | PIN2_bm);   // SCK (PC0) and MOSI (PC2) output
-
-    // DISP_LATCH
-    PORTA.OUTSET = PIN1_bm;        // DISP_LATCH initial high
-    PORTA.DIRSET = PIN1_bm;        // set DISP_LATCH pin as output
-
-    SPI0.CTRLA = SPI_MASTER_bm;    // Master, /4 prescaler, MSB first
-    SPI0.CTRLB = SPI_SSD_bm;       // Mode 0, client select disable, unbuffered
-    SPI0.INTCTRL = SPI_IE_bm;      // Interrupt enable
-    SPI0.CTRLA |= SPI_ENABLE_bm;   // Enable
+    // SPI0 on PC0-3 (master, /4, mode 0, interrupt enabled), DISP_LATCH high
+    hal_display_init();
 }//display_init
 
 void find_dec_digits(uint8_t num, uint8_t *hundreds, uint8_t *tens, uint8_t *units) {
@@ -78,6 +66,7 @@ void find_hex_digits(uint8_t num, uint8_t* digit1, uint8_t* digit0) {
 void set_display_segments(uint8_t segs_l, uint8_t segs_r) {
     digit_l = segs_l;
     digit_r = segs_r;
+    latency_mark(LAT_SEGMENTS);
 }//set_display_segments
 
 // // Assumes num_l and num_r are in the range 0..15
@@ -87,7 +76,7 @@ void set_display_numbers(uint8_t num_l, uint8_t num_r) {
 }//set_display_segments
 
 void display_write(uint8_t data) {
-    SPI0.DATA = data;              // Note DATA register used for both Tx and Rx
+    hal_spi_write(data);
 }//display_write
 
 void swap_display_digit(void) {
@@ -101,9 +90,9 @@ void swap_display_digit(void) {
 }//swap_digit
 
 ISR(SPI0_INT_vect){
-    //rising edge on DISP_LATCH
-    PORTA.OUTCLR = PIN1_bm;
-    PORTA.OUTSET = PIN1_bm;  
-
-    SPI0.INTFLAGS = SPI_IF_bm;
+    PROFILE_ISR_ENTER();
+    //rising edge on DISP_LATCH, clears the interrupt flag
+    hal_display_latch();
+    latency_mark(LAT_LATCH);
+    PROFILE_ISR_EXIT(PROF_SPI0);
 }
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include <stdint.h>
+#include "hal.h"
+
+#include "flightrec.h"
+
+#if FLIGHTREC
+
+#include "timer.h"
+#include "uart.h"
+
+#define FR_MASK  (FR_ENTRIES - 1)
+#define FR_MAGIC 0xF17Eu
+
+typedef struct {
+    uint8_t kind;
+    uint8_t value;
+    uint16_t t;
+} fr_rec_t;
+
+// Left alone by the C startup code, so it carries over a reset
+static struct {
+    uint16_t magic;
+    uint8_t head;                       // next slot to write
+    uint8_t count;                      // records held, up to FR_ENTRIES
+    fr_rec_t rec[FR_ENTRIES];
+} fr HAL_NOINIT;
+_Static_assert(sizeof(fr) == 4 + 4 * FR_ENTRIES, "flight recorder SRAM budget");
+
+// Dump in progress: oldest slot and number of records when "!fr" came in,
+// and the next of them to print
+#define ROW_MAX_LEN 28      // "65535 input uart 3 release\n"; a reset row
+                            // with several causes may wait for the ring
+static uint8_t dump_start;
+static uint8_t dump_count;
+static uint8_t dump_row = UART_ROW_NONE;
+
+static const char kind_names[3][7] PROGMEM = { "reset", "state", "input" };
+static const char source_names[2][6] PROGMEM = { " pb ", " uart " };
+static const char reset_names[6][6] PROGMEM = { " por", " bor", " ext", " wdt", " sw", " updi" };
+
+void flightrec_clear(void)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        fr.magic = FR_MAGIC;
+        fr.head = 0;
+        fr.count = 0;
+        dump_row = UART_ROW_NONE;
+    }
+}
+
+void flightrec_init(uint8_t flags)
+{
+    // After power-on, or a crash in the middle of a write, the RAM
+    // holds garbage
+    if ((flags & HAL_RESET_POWER_ON) || fr.magic != FR_MAGIC ||
+        fr.head >= FR_ENTRIES || fr.count > FR_ENTRIES) {
+        flightrec_clear();
+    }
+    flightrec_record(FR_RESET, flags);
+}
+
+void flightrec_record(uint8_t kind, uint8_t value)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        fr_rec_t *r = &fr.rec[fr.head];
+        r->kind = kind;
+        r->value = value;
+        r->t = uptime_ms;
+        fr.head = (fr.head + 1) & FR_MASK;
+        if (fr.count < FR_ENTRIES) fr.count++;
+    }
+}
+
+// "fr <n>", then the n records from flightrec_service()
+void flightrec_dump(void)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        dump_start = (fr.head - fr.count) & FR_MASK;
+        dump_count = fr.count;
+    }
+    dump_row = dump_count ? 0 : UART_ROW_NONE;
+    uart_put_field_P(PSTR("fr "), dump_count);
+    uart_putc('\n');
+}
+
+// "<t_ms> state <n>", "<t_ms> input pb|uart <button> press|release" or
+// "<t_ms> reset <cause>..."
+static void put_record(const fr_rec_t *r)
+{
+    uart_put_u16(r->t);
+    uart_putc(' ');
+    uart_put_str_P(kind_names[r->kind]);
+    if (r->kind == FR_STATE) {
+        uart_put_field_P(PSTR(" "), r->value);
+    } else if (r->kind == FR_INPUT) {
+        uart_put_str_P(source_names[(r->value >> 3) & 1]);
+        uart_put_u16(r->value & 3);
+        uart_put_str_P((r->value & 4) ? PSTR(" release") : PSTR(" press"));
+    } else {
+        for (uint8_t k = 0; k < 6; k++) {
+            if (r->value & (1 << k)) uart_put_str_P(reset_names[k]);
+        }
+    }
+    uart_putc('\n');
+}
+
+void flightrec_service(void)
+{
+    uint8_t row = uart_report_row(&dump_row, dump_count, ROW_MAX_LEN);
+    if (row == UART_ROW_NONE) return;
+
+    // Copied first, as an ISR may be overwriting the oldest records
+    fr_rec_t r;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        r = fr.rec[(dump_start + row) & FR_MASK];
+    }
+    put_record(&r);
+}
+
+#endif
@@ -0,0 +1,614 @@
+#include <stdint.h>
+#include "hal.h"
+
+#include "game.h"
+#include "timer.h"
+#include "buzzer.h"
+#include "adc.h"
+#include "display.h"
+#include "display_macros.h"
+#include "uart.h"
+#include "sequencing.h"
+#include "telemetry.h"
+#include "highscore.h"
+#include "profile.h"
+#include "latency.h"
+#include "input.h"
+#include "buttons.h"
+#include "tlog.h"
+#include "flightrec.h"
+
+#define MIN_PLAYBACK_DELAY 250
+#define MAX_PLAYBACK_DELAY 2000
+#define FAIL_TONE_HZ 400
+#define HS_TIMEOUT_MS 5000
+
+// Simon game variables
+static Game_State state = PLAYBACK_START;
+// Steps are never stored: playback and input checking each walk the LFSR
+// from round_start_state, one step at a time
+static uint32_t round_start_state = 0;
+static uint32_t round_end_state = 0;    // LFSR after the last step played
+static uint16_t len = 0;
+static uint16_t i = 0;
+static uint16_t pb_step_index = 0;
+static uint16_t step_on_at = 0;         // uptime_ms the current step was due
+static int8_t input_button = -1;
+static uint8_t pb_released = 0;
+
+// Timing, refreshed every pass
+static uint16_t playback_delay = MIN_PLAYBACK_DELAY;
+static uint16_t half_delay = MIN_PLAYBACK_DELAY >> 1;
+static uint16_t reported_delay = 0;
+
+// High score name entry
+static char hs_name[HS_NAME_MAX + 1];
+static uint8_t hs_name_len = 0;
+static uint8_t hs_row = 0;
+
+// ---- actions ----------------------------------------------------------- //
+
+// An action runs the side effects of one transition and may return a
+// follow-up event (EV_NEXT/EV_DONE/EV_FAIL) to pick between next states
+typedef uint8_t (*game_action_t)(uint8_t ev);
+
+static uint16_t now_ms(void)
+{
+    uint16_t t;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        t = uptime_ms;
+    }
+    return t;
+}
+
+// elapsed_time is bumped by the TCB0 ISR, so it is only read and cleared
+// as a whole; a torn read at a byte carry could end a timeout early
+static uint16_t elapsed_ms(void)
+{
+    uint16_t t;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        t = elapsed_time;
+    }
+    return t;
+}
+
+static void elapsed_reset(void)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        elapsed_time = 0;
+    }
+}
+
+static void show_step(uint8_t step)
+{
+    buzzer_on(step);
+    set_display_segments(left_patterns[step], right_patterns[step]);
+}
+
+static void outputs_off(void)
+{
+    buzzer_stop();
+    set_display_segments(DISP_OFF, DISP_OFF);
+}
+
+static void print_result_P(const char *msg)
+{
+    uart_put_str_P(msg);
+    uart_put_u16(len);
+    uart_putc('\n');
+}
+
+static uint8_t act_none(uint8_t ev)
+{
+    (void)ev;
+    return EV_NONE;
+}
+
+static uint8_t act_round_start(uint8_t ev)
+{
+    (void)ev;
+    if (len == 0) round_start_state = sequencing_save_state();
+    if (len != 0xFFFF) len++;               // the top score replays at 65535
+
+    sequencing_restore_state(round_start_state);
+    uint8_t step = sequencing_next_step();
+
+    pb_step_index = 0;
+    step_on_at = now_ms();
+    telemetry_emit(TLM_STEP, step);
+    show_step(step);
+    return EV_NONE;
+}
+
+static uint8_t act_outputs_off(uint8_t ev)
+{
+    (void)ev;
+    outputs_off();
+    return EV_NONE;
+}
+
+static uint8_t act_step_next(uint8_t ev)
+{
+    (void)ev;
+    pb_step_index++;
+    if (pb_step_index < len) return EV_NEXT;
+    round_end_state = sequencing_save_state();
+    return EV_DONE;
+}
+
+static uint8_t act_step_play(uint8_t ev)
+{
+    (void)ev;
+    // Due one delay after the last step, not after this pass, so loop
+    // latency never adds up. Only a pot jump or a stall can put us more
+    // than half a step late, and then the schedule restarts from now.
+    uint16_t now = now_ms();
+    step_on_at += playback_delay;
+    if ((int16_t)(now - step_on_at) > (int16_t)half_delay) step_on_at = now;
+
+    uint8_t step = sequencing_next_step();
+    telemetry_emit(TLM_STEP, step);
+    show_step(step);
+    return EV_NONE;
+}
+
+static uint8_t act_input_begin(uint8_t ev)
+{
+    (void)ev;
+    i = 0;
+    sequencing_restore_state(round_start_state);   // replay the round to check inputs
+    uart_input_enabled = 1;
+    return EV_NONE;
+}
+
+static uint8_t act_echo_button(uint8_t ev)
+{
+    latency_mark(LAT_INPUT);
+    input_button = ev - EV_BUTTON_0;
+    pb_released = 0;                // Wait for button release
+    telemetry_emit(TLM_INPUT, (TLM_SRC_PB << 8) | (uint8_t)input_button);
+    show_step((uint8_t)input_button);
+    return EV_NONE;
+}
+
+static uint8_t act_echo_uart(uint8_t ev)
+{
+    input_button = ev - EV_UART_0;
+    pb_released = 1;                // UART has no button to release
+    telemetry_emit(TLM_INPUT, (TLM_SRC_UART << 8) | (uint8_t)input_button);
+    show_step((uint8_t)input_button);
+    return EV_NONE;
+}
+
+static uint8_t act_released(uint8_t ev)
+{
+    (void)ev;
+    pb_released = 1;
+    return EV_NONE;
+}
+
+static uint8_t act_echo_end(uint8_t ev)
+{
+    (void)ev;
+    outputs_off();
+    uint8_t expected = sequencing_next_step();
+    if ((uint8_t)input_button != expected) {
+        TLOG2("button %u pressed, expected %u", input_button, expected);
+        return EV_FAIL;
+    }
+    i++;
+    return (i == len) ? EV_DONE : EV_NEXT;
+}
+
+static uint8_t act_success(uint8_t ev)
+{
+    (void)ev;
+    uart_input_enabled = 0;
+    set_display_segments(DISP_ON, DISP_ON);
+    telemetry_emit(TLM_SUCCESS, len);
+    print_result_P(PSTR("SUCCESS\n"));
+    return EV_NONE;
+}
+
+static uint8_t act_fail(uint8_t ev)
+{
+    (void)ev;
+    uart_input_enabled = 0;
+    telemetry_emit(TLM_FAIL, len);
+    print_result_P(PSTR("GAME OVER\n"));
+    set_display_segments(DISP_DASH, DISP_DASH);
+    buzzer_start_hz(FAIL_TONE_HZ);
+    return EV_NONE;
+}
+
+static uint8_t act_fail_score(uint8_t ev)
+{
+    (void)ev;
+    buzzer_stop();
+    uint8_t show = len % 100;
+    uint8_t tens = show / 10, ones = show % 10;
+    uint8_t left_mask = (tens == 0 && len < 100) ? DISP_OFF : digit_masks[tens];
+    set_display_segments(left_mask, digit_masks[ones]);
+    return EV_NONE;
+}
+
+static uint8_t act_fail_end(uint8_t ev)
+{
+    (void)ev;
+    // Advance LFSR past the failed sequence
+    sequencing_restore_state(round_end_state);
+    return highscore_qualifies(len) ? EV_NEXT : EV_DONE;
+}
+
+static uint8_t act_new_game(uint8_t ev)
+{
+    (void)ev;
+    len = 0;
+    return EV_NONE;
+}
+
+static uint8_t act_hs_prompt(uint8_t ev)
+{
+    (void)ev;
+    uart_name_entry(1);
+    uart_put_str_P(PSTR("Enter name: "));
+    hs_name_len = 0;
+    return EV_NONE;
+}
+
+static uint8_t act_name_poll(uint8_t ev)
+{
+    (void)ev;
+    int16_t c;
+    while ((c = uart_name_getc()) >= 0) {
+        if (c == '\n') return EV_DONE;
+        if (c != '\r') {
+            if (hs_name_len < HS_NAME_MAX) hs_name[hs_name_len++] = (char)c;
+            elapsed_reset();        // 5 s from the prompt, then from each char
+        }
+    }
+    return EV_NONE;
+}
+
+static uint8_t act_name_end(uint8_t ev)
+{
+    (void)ev;
+    uart_name_entry(0);
+    hs_name[hs_name_len] = '\0';
+    highscore_insert(hs_name, len);
+    uart_putc('\n');
+    hs_row = 0;
+    return EV_NONE;
+}
+
+static uint8_t act_hs_row(uint8_t ev)
+{
+    (void)ev;
+    // One row per pass, only once it fits in the TX ring
+    uint8_t row_len = highscore_row_len(hs_row);
+    if (row_len == 0) return EV_DONE;
+    if (uart_tx_free() >= row_len) highscore_print_row(hs_row++);
+    return EV_NONE;
+}
+
+// RESET: end the game, default octave, back to the seed, length one
+static uint8_t act_reset(uint8_t ev)
+{
+    (void)ev;
+    uart_input_enabled = 0;
+    uart_name_entry(0);
+    outputs_off();
+    reset_octave();
+    telemetry_emit(TLM_OCTAVE, 0);
+    sequencing_init(GAME_SEED);
+    len = 0;
+    return EV_NONE;
+}
+
+typedef enum {
+    A_NONE,
+    A_ROUND_START,
+    A_OUTPUTS_OFF,
+    A_STEP_NEXT,
+    A_STEP_PLAY,
+    A_INPUT_BEGIN,
+    A_ECHO_BUTTON,
+    A_ECHO_UART,
+    A_RELEASED,
+    A_ECHO_END,
+    A_SUCCESS,
+    A_FAIL,
+    A_FAIL_SCORE,
+    A_FAIL_END,
+    A_NEW_GAME,
+    A_HS_PROMPT,
+    A_NAME_POLL,
+    A_NAME_END,
+    A_HS_ROW,
+    A_RESET,
+    A_NUM
+} game_action_id_t;
+
+static const game_action_t actions[A_NUM] PROGMEM = {
+    [A_NONE]        = act_none,
+    [A_ROUND_START] = act_round_start,
+    [A_OUTPUTS_OFF] = act_outputs_off,
+    [A_STEP_NEXT]   = act_step_next,
+    [A_STEP_PLAY]   = act_step_play,
+    [A_INPUT_BEGIN] = act_input_begin,
+    [A_ECHO_BUTTON] = act_echo_button,
+    [A_ECHO_UART]   = act_echo_uart,
+    [A_RELEASED]    = act_released,
+    [A_ECHO_END]    = act_echo_end,
+    [A_SUCCESS]     = act_success,
+    [A_FAIL]        = act_fail,
+    [A_FAIL_SCORE]  = act_fail_score,
+    [A_FAIL_END]    = act_fail_end,
+    [A_NEW_GAME]    = act_new_game,
+    [A_HS_PROMPT]   = act_hs_prompt,
+    [A_NAME_POLL]   = act_name_poll,
+    [A_NAME_END]    = act_name_end,
+    [A_HS_ROW]      = act_hs_row,
+    [A_RESET]       = act_reset,
+};
+
+// ---- tables ------------------------------------------------------------ //
+
+typedef struct {
+    uint8_t action;
+    uint8_t next;       // state + 1, 0 stays in the current state
+} game_transition_t;
+
+#define GO(action, state)   { (action), (state) + 1 }
+#define STAY(action)        { (action), 0 }
+#define BUTTONS(action, state) \
+    [EV_BUTTON_0] = GO(action, state), [EV_BUTTON_1] = GO(action, state), \
+    [EV_BUTTON_2] = GO(action, state), [EV_BUTTON_3] = GO(action, state)
+#define UART_KEYS(action, state) \
+    [EV_UART_0] = GO(action, state), [EV_UART_1] = GO(action, state), \
+    [EV_UART_2] = GO(action, state), [EV_UART_3] = GO(action, state)
+#define ON_RESET            [EV_RESET] = GO(A_RESET, PLAYBACK_START)
+
+// Empty cells are { A_NONE, stay }: the event is ignored in that state
+static const game_transition_t transitions[GAME_NUM_STATES][GAME_NUM_EVENTS] PROGMEM = {
+    [PLAYBACK_START] = {
+        [EV_TIMEOUT] = GO(A_ROUND_START, PLAYBACK_STEP_ON),
+        ON_RESET,
+    },
+    [PLAYBACK_STEP_ON] = {
+        [EV_TIMEOUT] = GO(A_OUTPUTS_OFF, PLAYBACK_STEP_OFF),
+        ON_RESET,
+    },
+    [PLAYBACK_STEP_OFF] = {
+        [EV_TIMEOUT] = STAY(A_STEP_NEXT),
+        [EV_NEXT]    = GO(A_STEP_PLAY, PLAYBACK_STEP_ON),
+        [EV_DONE]    = GO(A_INPUT_BEGIN, INPUT_WAITING),
+        ON_RESET,
+    },
+    [INPUT_WAITING] = {
+        BUTTONS(A_ECHO_BUTTON, INPUT_ECHO_ON),
+        UART_KEYS(A_ECHO_UART, INPUT_ECHO_ON),
+        ON_RESET,
+    },
+    [INPUT_ECHO_ON] = {
+        [EV_RELEASE] = STAY(A_RELEASED),
+        [EV_TIMEOUT] = STAY(A_ECHO_END),
+        [EV_NEXT]    = GO(A_NONE, INPUT_WAITING),
+        [EV_DONE]    = GO(A_SUCCESS, SUCCESS_SHOW),
+        [EV_FAIL]    = GO(A_FAIL, FAIL_SHOW),
+        ON_RESET,
+    },
+    [SUCCESS_SHOW] = {
+        [EV_TIMEOUT] = GO(A_OUTPUTS_OFF, PLAYBACK_START),
+        ON_RESET,
+    },
+    [FAIL_SHOW] = {
+        [EV_TIMEOUT] = GO(A_FAIL_SCORE, FAIL_SCORE_SHOW),
+        ON_RESET,
+    },
+    [FAIL_SCORE_SHOW] = {
+        [EV_TIMEOUT] = GO(A_OUTPUTS_OFF, FAIL_WAIT),
+        ON_RESET,
+    },
+    [FAIL_WAIT] = {
+        [EV_TIMEOUT] = STAY(A_FAIL_END),
+        [EV_NEXT]    = GO(A_NONE, HS_PROMPT),
+        [EV_DONE]    = GO(A_NEW_GAME, PLAYBACK_START),
+        ON_RESET,
+    },
+    [HS_PROMPT] = {
+        [EV_TIMEOUT] = GO(A_HS_PROMPT, HS_NAME_ENTRY),
+        ON_RESET,
+    },
+    [HS_NAME_ENTRY] = {
+        [EV_POLL]    = STAY(A_NAME_POLL),
+        [EV_DONE]    = GO(A_NAME_END, HS_PRINT),
+        [EV_TIMEOUT] = GO(A_NAME_END, HS_PRINT),
+    },
+    [HS_PRINT] = {
+        [EV_POLL]    = STAY(A_HS_ROW),
+        [EV_DONE]    = GO(A_NEW_GAME, PLAYBACK_START),
+        ON_RESET,
+    },
+};
+
+// When EV_TIMEOUT is raised in each state
+typedef enum {
+    TO_NEVER,
+    TO_NOW,             // on the first pass
+    TO_STEP_HALF,       // half the playback delay after the step was due
+    TO_STEP_END,        // the playback delay after the step was due
+    TO_HALF_RELEASED,   // elapsed_time >= half, and the button is up
+    TO_FULL,            // elapsed_time > playback delay
+    TO_NAME,            // no name character for HS_TIMEOUT_MS
+} game_timeout_t;
+
+static const uint8_t state_timeout[GAME_NUM_STATES] PROGMEM = {
+    [PLAYBACK_START]    = TO_NOW,
+    [PLAYBACK_STEP_ON]  = TO_STEP_HALF,
+    [PLAYBACK_STEP_OFF] = TO_STEP_END,
+    [INPUT_WAITING]     = TO_NEVER,
+    [INPUT_ECHO_ON]     = TO_HALF_RELEASED,
+    [SUCCESS_SHOW]      = TO_FULL,
+    [FAIL_SHOW]         = TO_FULL,
+    [FAIL_SCORE_SHOW]   = TO_FULL,
+    [FAIL_WAIT]         = TO_FULL,
+    [HS_PROMPT]         = TO_NOW,
+    [HS_NAME_ENTRY]     = TO_NAME,
+    [HS_PRINT]          = TO_NEVER,
+};
+
+// ---- speculative echo ------------------------------------------------- //
+
+#if PB_SPECULATE
+
+#ifndef PB_SPECULATE_MS
+#define PB_SPECULATE_MS 30      // debounce takes 10-16 ms, plus margin
+#endif
+#define SPEC_NONE 0xFF
+
+static uint8_t spec_button = SPEC_NONE;
+static uint16_t spec_start;
+static uint16_t spec_started, spec_committed, spec_rolled_back;
+
+static void spec_end(uint8_t committed)
+{
+    if (committed) {
+        if (spec_committed != 0xFFFF) spec_committed++;
+    } else {
+        if (spec_rolled_back != 0xFFFF) spec_rolled_back++;
+    }
+    spec_button = SPEC_NONE;
+}
+
+// Echo the first raw edge in INPUT_WAITING; drop an echo nothing confirmed
+static void spec_service(void)
+{
+    uint8_t raw;
+    uint16_t now;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        raw = pb_raw_falling;
+        pb_raw_falling = 0;
+        now = uptime_ms;
+    }
+
+    if (spec_button == SPEC_NONE) {
+        if (state != INPUT_WAITING || !(raw & 0xF0)) return;
+        uint8_t b = 0;
+        while (!(raw & (PIN4_bm << b))) b++;
+        spec_button = b;
+        spec_start = now;
+        if (spec_started != 0xFFFF) spec_started++;
+        show_step(b);
+    } else if ((uint16_t)(now - spec_start) > PB_SPECULATE_MS) {
+        // Only undo our own outputs; any other state has replaced them
+        if (state == INPUT_WAITING) outputs_off();
+        spec_end(0);
+    }
+}
+
+// A debounced press settles the pending echo either way; a different
+// button replaces it through the normal echo
+static void spec_confirm(uint8_t button)
+{
+    if (spec_button != SPEC_NONE) spec_end(button == spec_button);
+}
+
+// "spec N commit N rollback N"
+void game_spec_report(void)
+{
+    uart_put_field_P(PSTR("spec "), spec_started);
+    uart_put_field_P(PSTR(" commit "), spec_committed);
+    uart_put_field_P(PSTR(" rollback "), spec_rolled_back);
+    uart_putc('\n');
+}
+
+#else
+
+#define spec_service()          ((void)0)
+#define spec_confirm(button)    ((void)0)
+
+#endif
+
+// ---- dispatch ---------------------------------------------------------- //
+
+// One table lookup per event, then again for any follow-up event
+static void game_dispatch(uint8_t ev)
+{
+    while (ev != EV_NONE) {
+        const game_transition_t *t = &transitions[state][ev];
+        uint8_t next = pgm_read_byte(&t->next);
+        game_action_t action = (game_action_t)pgm_read_ptr(&actions[pgm_read_byte(&t->action)]);
+
+        ev = action(ev);
+        if (next && (uint8_t)(next - 1) != (uint8_t)state) {
+            TLOG2("state %u -> %u", state, next - 1);
+            flightrec_record(FR_STATE, next - 1);
+            state = (Game_State)(next - 1);
+            elapsed_reset();
+        }
+    }
+}
+
+static uint8_t game_timed_out(void)
+{
+    switch (pgm_read_byte(&state_timeout[state])) {
+        case TO_NOW:            return 1;
+        case TO_STEP_HALF:      return (uint16_t)(now_ms() - step_on_at) >= half_delay;
+        case TO_STEP_END:       return (uint16_t)(now_ms() - step_on_at) >= playback_delay;
+        case TO_HALF_RELEASED:  return pb_released && elapsed_ms() >= half_delay;
+        case TO_FULL:           return elapsed_ms() > playback_delay;
+        case TO_NAME:           return elapsed_ms() >= HS_TIMEOUT_MS;
+        default:                return 0;
+    }
+}
+
+void game_init(void)
+{
+    outputs_off();
+}
+
+void game_service(void)
+{
+    // Read potentiometer continuously (free-running ADC updates this)
+    playback_delay = (((uint16_t) (MAX_PLAYBACK_DELAY - MIN_PLAYBACK_DELAY) * adc_read8()) >> 8) + MIN_PLAYBACK_DELAY;
+    half_delay = playback_delay >> 1;  // Pre-compute 50% to avoid re-reading ADC mid-state
+
+    // Report pot moves, ignoring ADC jitter of a couple of LSBs (~7 ms each)
+    if ((uint16_t)(playback_delay - reported_delay + 16) > 32) {
+        reported_delay = playback_delay;
+        telemetry_emit(TLM_DELAY, playback_delay);
+    }
+
+    spec_service();
+
+    // Events in a fixed order: reset, queued inputs oldest first, poll, timeout
+    if (uart_reset_request) {
+        uart_reset_request = 0;
+        game_dispatch(EV_RESET);
+    }
+
+    // While an echo is on, later inputs wait in the FIFO so it runs its full
+    // length; only the echoed button's release is taken out of turn
+    if (state == INPUT_ECHO_ON && !pb_released && input_take_release((uint8_t)input_button)) {
+        game_dispatch(EV_RELEASE);
+    }
+
+    input_event_t in;
+    while (state != INPUT_ECHO_ON && input_get(&in)) {
+        if (in.edge == INPUT_PRESS) {
+            if (in.source == INPUT_SRC_PB) spec_confirm(in.button);
+            game_dispatch((in.source == INPUT_SRC_UART ? EV_UART_0 : EV_BUTTON_0) + in.button);
+        } else if (in.button == (uint8_t)input_button) {
+            game_dispatch(EV_RELEASE);
+        }
+    }
+
+    game_dispatch(EV_POLL);
+    if (game_timed_out()) game_dispatch(EV_TIMEOUT);
+}
+
+Game_State game_state(void)
+{
+    return state;
+}
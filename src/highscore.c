@@ -1,146 +1,211 @@
-// #include "highscore.h"
-// #include <avr/io.h>
-// #include <stdint.h>
-// #include "timer.h"
-// #include "uart.h"
-
-// #ifndef F_CPU
-// #endif
-
-// /* UART helpers */
-// static inline uint8_t hs_uart_rx_ready(void) {
-//     return (USART0.STATUS & USART_RXCIF_bm) ? 1u : 0u;
-// }
-// static inline char hs_uart_getc_now(void) {
-//     return USART0.RXDATAL;
-// }
-// static inline void hs_uart_putc(char c) {
-//     while (!(USART0.STATUS & USART_DREIF_bm)) { /* wait */ }
-//     USART0.TXDATAL = c;
-// }
-// static inline void hs_uart_puts(const char *s) {
-//     while (*s) hs_uart_putc(*s++);
-// }
-
-// /* Table in SRAM */
-// #define HS_MAX 5
-// typedef struct { char name[21]; uint16_t score; uint8_t used; } hs_entry_t;
-// static hs_entry_t hs[HS_MAX];
-
-// /* Utilities */
-// static void hs_print_u16(uint16_t v) {
-//     char buf[6];
-//     int8_t i = 0;
-//     if (v == 0) { hs_uart_putc('0'); return; }
-//     while (v > 0 && i < 5) { buf[i++] = '0' + (v % 10u); v /= 10u; }
-//     while (--i >= 0) hs_uart_putc(buf[i]);
-// }
-
-// static uint8_t hs_size(void) {
-//     uint8_t n = 0;
-//     for (uint8_t i = 0; i < HS_MAX; i++) if (hs[i].used) n++;
-//     return n;
-// }
-
-// /* Find insertion index for score (descending) */
-// static uint8_t hs_find_pos(uint16_t score) {
-//     uint8_t n = hs_size();
-//     for (uint8_t i = 0; i < n; i++) {
-//         if (!hs[i].used || score > hs[i].score) return i;
-//     }
-//     return n; /* at end */
-// }
-
-// /* Insert (name,score) at pos, shifting down and trimming to HS_MAX */
-// static void hs_insert_at(uint8_t pos, const char *name, uint16_t score) {
-//     uint8_t n = hs_size();
-//     if (n < HS_MAX) n++; /* room grows by one */
-//     if (pos > n) pos = n;
-
-//     /* shift down */
-//     for (int8_t i = (int8_t)(n - 1); i > (int8_t)pos; i--) {
-//         hs[i] = hs[i - 1];
-//     }
-
-//     /* copy new */
-//     hs[pos].score = score;
-//     hs[pos].used  = 1;
-
-//     /* copy up to 20 chars, NUL-terminate */
-//     uint8_t k = 0;
-//     while (name[k] && k < 20) { hs[pos].name[k] = name[k]; k++; }
-//     hs[pos].name[k] = '\0';
-// }
-
-// uint8_t highscore_qualifies(uint16_t score) {
-//     uint8_t n = hs_size();
-//     if (n < HS_MAX) return 1;
-//     // table full
-//     return (score > hs[n - 1].score) ? 1u : 0u;
-// }
-
-// void highscore_prompt_and_store(uint16_t score) {
-//     extern volatile uint16_t elapsed_time;
-//     char name[21];
-//     uint8_t len = 0;
-
-//     hs_uart_puts("Enter name: ");
-
-//     const uint16_t TOUT_MS = 5000;
-//     elapsed_time = 0;
-//     uint16_t last_char_time = 0;
-
-//     while (1) {
-//         if (hs_uart_rx_ready()) {
-//             char c = hs_uart_getc_now();
-
-//             if (c == '\r') {
-//                 continue;
-//             }
-//             if (c == '\n') {
-//                 break;
-//             }
-
-//             if (len < 20) {
-//                 name[len++] = c;
-//             }
-//             last_char_time = elapsed_time;
-//         }
-
-//         if (len == 0) {
-//             if (elapsed_time >= TOUT_MS) break;
-//         } else {
-//             if ((elapsed_time - last_char_time) >= TOUT_MS) break;
-//         }
-//     }
-
-//     name[len] = '\0';
-
-//     /* store into table (descending) */
-//     uint8_t pos = hs_find_pos(score);
-//     if (pos < HS_MAX) {
-//         hs_insert_at(pos, name, score);
-//     }
-
-//     /* then print table */
-//     hs_uart_puts("\n");
-//     for (uint8_t i = 0; i < HS_MAX; i++) {
-//         if (!hs[i].used) break;
-//         const char *p = hs[i].name;
-//         while (*p) hs_uart_putc(*p++);
-//         hs_uart_putc(' ');
-//         hs_print_u16(hs[i].score);
-//         hs_uart_putc('\n');
-//     }
-// }
-
-// void highscore_print_table(void) {
-//     for (uint8_t i = 0; i < HS_MAX; i++) {
-//         if (!hs[i].used) break;
-//         const char *p = hs[i].name;
-//         while (*p) hs_uart_putc(*p++);
-//         hs_uart_putc(' ');
-//         hs_print_u16(hs[i].score);
-//         hs_uart_putc('\n');
-//     }
-// }
+#include "highscore.h"
+#include <stddef.h>
+#include <stdint.h>
+#include "uart.h"
+#if HS_PERSIST
+#include "hal.h"
+#include "nvm.h"
+#endif
+
+/* Table in SRAM */
+typedef struct { char name[HS_NAME_MAX + 1]; uint16_t score; uint8_t used; } hs_entry_t;
+static hs_entry_t hs[HS_MAX];
+
+#if HS_PERSIST
+/* EEPROM image. Two slots of 4 pages each; every save goes to the slot not
+   holding the newest record, so each page sees half the writes, and pages
+   whose contents did not change are skipped. The newest slot is the one
+   with a valid CRC and the higher sequence number (mod 256). */
+#define HS_VERSION    1
+#define HS_SLOT_PAGES 4
+#define HS_SLOT_SIZE  (HS_SLOT_PAGES * NVM_EEPROM_PAGE)
+#define HS_NUM_SLOTS  (NVM_EEPROM_SIZE / HS_SLOT_SIZE)
+
+typedef struct {
+    uint8_t version;
+    uint8_t seq;
+    struct { uint16_t score; char name[HS_NAME_MAX]; } entry[HS_MAX];  /* score 0 = unused */
+    uint16_t crc;
+} hs_record_t;
+
+typedef union {
+    hs_record_t rec;
+    uint8_t bytes[HS_SLOT_SIZE];
+} hs_image_t;
+
+_Static_assert(sizeof(hs_record_t) <= HS_SLOT_SIZE, "high score record exceeds its EEPROM slot");
+_Static_assert(HS_NUM_SLOTS >= 2, "EEPROM too small for two high score slots");
+
+static hs_image_t hs_image;                 /* staging copy for the background writer */
+static uint8_t hs_dirty = 0;
+static uint8_t hs_writing = 0;
+static uint8_t hs_page = 0;
+static uint8_t hs_slot = HS_NUM_SLOTS - 1;  /* slot holding the newest record */
+static uint8_t hs_target = 0;
+static uint8_t hs_seq = 0;
+
+/* CRC-16/CCITT (poly 0x1021, init 0xFFFF), nibble table */
+static const uint16_t crc16_nibble[16] PROGMEM = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+static uint16_t hs_crc16(const volatile uint8_t *p, uint8_t n) {
+    uint16_t crc = 0xFFFF;
+    while (n--) {
+        crc ^= (uint16_t)*p++ << 8;
+        crc = (crc << 4) ^ pgm_read_word(&crc16_nibble[crc >> 12]);
+        crc = (crc << 4) ^ pgm_read_word(&crc16_nibble[crc >> 12]);
+    }
+    return crc;
+}
+
+#define HS_CRC_LEN ((uint8_t)offsetof(hs_record_t, crc))
+
+static uint8_t hs_slot_valid(uint8_t slot) {
+    const volatile uint8_t *p = nvm_eeprom_ptr(slot * HS_SLOT_SIZE);
+    const volatile hs_record_t *r = (const volatile hs_record_t *)p;
+    return r->version == HS_VERSION && r->crc == hs_crc16(p, HS_CRC_LEN);
+}
+#endif
+
+/* Utilities */
+static uint8_t hs_size(void) {
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < HS_MAX; i++) if (hs[i].used) n++;
+    return n;
+}
+
+static uint8_t hs_digits(uint16_t v) {
+    uint8_t d = 1;
+    while (v >= 10) { v /= 10; d++; }
+    return d;
+}
+
+/* Find insertion index for score (descending) */
+static uint8_t hs_find_pos(uint16_t score) {
+    uint8_t n = hs_size();
+    for (uint8_t i = 0; i < n; i++) {
+        if (score > hs[i].score) return i;
+    }
+    return n; /* at end */
+}
+
+uint8_t highscore_qualifies(uint16_t score) {
+    uint8_t n = hs_size();
+    if (n < HS_MAX) return 1;
+    // table full
+    return (score > hs[n - 1].score) ? 1u : 0u;
+}
+
+void highscore_insert(const char *name, uint16_t score) {
+    uint8_t pos = hs_find_pos(score);
+    if (pos >= HS_MAX) return;
+
+    uint8_t n = hs_size();
+    if (n < HS_MAX) n++; /* room grows by one */
+
+    /* shift down, trimming to HS_MAX */
+    for (uint8_t i = n - 1; i > pos; i--) {
+        hs[i] = hs[i - 1];
+    }
+
+    hs[pos].score = score;
+    hs[pos].used  = 1;
+
+    /* copy up to 20 chars, NUL-terminate */
+    uint8_t k = 0;
+    while (name[k] && k < HS_NAME_MAX) { hs[pos].name[k] = name[k]; k++; }
+    hs[pos].name[k] = '\0';
+
+#if HS_PERSIST
+    hs_dirty = 1;
+#endif
+}
+
+uint8_t highscore_row_len(uint8_t idx) {
+    if (idx >= HS_MAX || !hs[idx].used) return 0;
+    uint8_t k = 0;
+    while (hs[idx].name[k]) k++;
+    return k + 1 + hs_digits(hs[idx].score) + 1;
+}
+
+void highscore_print_row(uint8_t idx) {
+    if (idx >= HS_MAX || !hs[idx].used) return;
+    const char *p = hs[idx].name;
+    while (*p) uart_putc(*p++);
+    uart_putc(' ');
+    uart_put_u16(hs[idx].score);
+    uart_putc('\n');
+}
+
+void highscore_load(void) {
+#if HS_PERSIST
+    uint8_t best = 0xFF;
+
+    for (uint8_t slot = 0; slot < HS_NUM_SLOTS; slot++) {
+        if (!hs_slot_valid(slot)) continue;
+        uint8_t seq = nvm_eeprom_ptr(slot * HS_SLOT_SIZE)[offsetof(hs_record_t, seq)];
+        if (best == 0xFF || (int8_t)(seq - hs_seq) > 0) {
+            best = slot;
+            hs_seq = seq;
+        }
+    }
+    if (best == 0xFF) return;           /* nothing valid: empty table */
+
+    hs_slot = best;
+    const volatile hs_record_t *r = (const volatile hs_record_t *)nvm_eeprom_ptr(best * HS_SLOT_SIZE);
+    for (uint8_t i = 0; i < HS_MAX; i++) {
+        hs[i].score = r->entry[i].score;
+        hs[i].used = (hs[i].score != 0);
+        for (uint8_t k = 0; k < HS_NAME_MAX; k++) hs[i].name[k] = r->entry[i].name[k];
+        hs[i].name[HS_NAME_MAX] = '\0';
+    }
+#endif
+}
+
+void highscore_service(void) {
+#if HS_PERSIST
+    if (!hs_writing) {
+        if (!hs_dirty) return;
+
+        /* Snapshot the table into the next slot's image */
+        hs_dirty = 0;
+        for (uint16_t k = 0; k < HS_SLOT_SIZE; k++) hs_image.bytes[k] = 0;
+        hs_image.rec.version = HS_VERSION;
+        hs_image.rec.seq = hs_seq + 1;
+        for (uint8_t i = 0; i < HS_MAX; i++) {
+            if (!hs[i].used) break;
+            hs_image.rec.entry[i].score = hs[i].score;
+            for (uint8_t k = 0; k < HS_NAME_MAX && hs[i].name[k]; k++) {
+                hs_image.rec.entry[i].name[k] = hs[i].name[k];
+            }
+        }
+        hs_image.rec.crc = hs_crc16(hs_image.bytes, HS_CRC_LEN);
+
+        hs_target = (hs_slot + 1) % HS_NUM_SLOTS;
+        hs_page = 0;
+        hs_writing = 1;
+    }
+
+    if (nvm_eeprom_busy()) return;
+
+    /* Skip pages that already hold the right bytes */
+    while (hs_page < HS_SLOT_PAGES) {
+        uint8_t off = hs_page * NVM_EEPROM_PAGE;
+        const volatile uint8_t *ee = nvm_eeprom_ptr(hs_target * HS_SLOT_SIZE + off);
+        uint8_t k = 0;
+        while (k < NVM_EEPROM_PAGE && ee[k] == hs_image.bytes[off + k]) k++;
+        hs_page++;
+        if (k < NVM_EEPROM_PAGE) {
+            nvm_eeprom_write_page(hs_target * HS_SLOT_SIZE + off, &hs_image.bytes[off]);
+            return;
+        }
+    }
+
+    /* All pages issued and the last write has finished */
+    hs_slot = hs_target;
+    hs_seq = hs_image.rec.seq;
+    hs_writing = 0;
+#endif
+}
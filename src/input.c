@@ -0,0 +1,131 @@
+#include <stdint.h>
+#include "hal.h"
+
+#include "input.h"
+#include "telemetry.h"
+#include "timer.h"
+#include "uart.h"
+#include "tlog.h"
+#include "flightrec.h"
+
+_Static_assert(INPUT_SRC_PB == TLM_SRC_PB && INPUT_SRC_UART == TLM_SRC_UART,
+               "input sources double as telemetry sources");
+
+// FIFO filled by the ISRs, drained by the game loop
+#define INPUT_FIFO_SIZE 16              // must be a power of two
+#define INPUT_FIFO_MASK (INPUT_FIFO_SIZE - 1)
+static volatile input_event_t fifo[INPUT_FIFO_SIZE];
+static volatile uint8_t fifo_head = 0;
+static volatile uint8_t fifo_tail = 0;
+
+static volatile uint16_t counts[INPUT_NUM_SOURCES][2];
+static volatile uint16_t dropped[INPUT_NUM_SOURCES];
+
+// Index of the lowest set bit of a nibble, so an edge mask is walked one
+// lookup per edge instead of one test per pin
+static const uint8_t lowest_bit[16] PROGMEM = {
+    0, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0
+};
+
+static inline void saturating_inc(volatile uint16_t *n)
+{
+    if (*n != 0xFFFF) (*n)++;
+}
+
+void input_push(uint8_t source, uint8_t button, uint8_t edge)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        uint8_t next = (fifo_head + 1) & INPUT_FIFO_MASK;
+        if (next == fifo_tail) {
+            saturating_inc(&dropped[source]);
+            TLOG2("input fifo full: source %u button %u", source, button);
+        } else {
+            volatile input_event_t *e = &fifo[fifo_head];
+            e->source = source;
+            e->button = button;
+            e->edge = edge;
+            e->t = uptime_ms;
+            fifo_head = next;
+            saturating_inc(&counts[source][edge]);
+            flightrec_record(FR_INPUT, (uint8_t)(source << 3 | edge << 2 | button));
+        }
+    }
+}
+
+void input_pb_edges(uint8_t changed, uint8_t now)
+{
+    uint8_t m = changed >> 4;           // PA4..PA7 -> buttons 0..3
+    while (m) {
+        uint8_t b = pgm_read_byte(&lowest_bit[m]);
+        input_push(INPUT_SRC_PB, b, (now >> (b + 4)) & 1 ? INPUT_RELEASE : INPUT_PRESS);
+        m &= m - 1;
+    }
+}
+
+uint8_t input_get(input_event_t *e)
+{
+    uint8_t tail = fifo_tail;
+    if (tail == fifo_head) return 0;
+    e->source = fifo[tail].source;
+    e->button = fifo[tail].button;
+    e->edge = fifo[tail].edge;
+    e->t = fifo[tail].t;
+    fifo_tail = (tail + 1) & INPUT_FIFO_MASK;
+    return 1;
+}
+
+uint8_t input_take_release(uint8_t button)
+{
+    // The ISRs only write at fifo_head, so everything from tail to head
+    // belongs to the main loop
+    uint8_t head = fifo_head;
+    for (uint8_t k = fifo_tail; k != head; k = (k + 1) & INPUT_FIFO_MASK) {
+        if (fifo[k].source != INPUT_SRC_PB || fifo[k].edge != INPUT_RELEASE ||
+            fifo[k].button != button) continue;
+
+        // Close the gap by moving the older entries up one slot
+        while (k != fifo_tail) {
+            uint8_t prev = (k - 1) & INPUT_FIFO_MASK;
+            fifo[k].source = fifo[prev].source;
+            fifo[k].button = fifo[prev].button;
+            fifo[k].edge = fifo[prev].edge;
+            fifo[k].t = fifo[prev].t;
+            k = prev;
+        }
+        fifo_tail = (fifo_tail + 1) & INPUT_FIFO_MASK;
+        return 1;
+    }
+    return 0;
+}
+
+uint16_t input_count(uint8_t source, uint8_t edge)
+{
+    uint16_t n;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        n = counts[source][edge];
+    }
+    return n;
+}
+
+uint16_t input_dropped(uint8_t source)
+{
+    uint16_t n;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        n = dropped[source];
+    }
+    return n;
+}
+
+static const char source_names[INPUT_NUM_SOURCES][5] PROGMEM = { "pb", "uart" };
+
+// "pb press N release N drop N"
+void input_report(void)
+{
+    for (uint8_t s = 0; s < INPUT_NUM_SOURCES; s++) {
+        uart_put_str_P(source_names[s]);
+        uart_put_field_P(PSTR(" press "), input_count(s, INPUT_PRESS));
+        uart_put_field_P(PSTR(" release "), input_count(s, INPUT_RELEASE));
+        uart_put_field_P(PSTR(" drop "), input_dropped(s));
+        uart_putc('\n');
+    }
+}
@@ -0,0 +1,77 @@
+#include <stdint.h>
+#include "hal.h"
+
+#include "irq.h"
+
+void irq_init(void)
+{
+#if IRQ_PRIORITY
+    hal_irq_priority_init();
+#endif
+}
+
+#if IRQ_STATS
+
+#include "timer.h"
+#include "uart.h"
+
+static uint16_t ticks;
+static uint16_t late;                   // ticks over IRQ_TCB1_BUDGET_US
+static uint32_t max_cycles;
+static uint16_t flood_left;
+
+#define BUDGET_CYCLES ((uint32_t)IRQ_TCB1_BUDGET_US * (TIMER_CCMP + 1) / 1000)
+
+// TCB1 restarts from 0 at the compare match that raised the interrupt, so
+// its count on entry is the latency in timer clocks
+void irq_tcb1_entry(void)
+{
+    uint32_t cycles = (uint32_t)hal_tcb_count(1) << BUTTONS_TCB_DIV2;
+    if (ticks != 0xFFFF) ticks++;
+    if (cycles > max_cycles) max_cycles = cycles;
+    if (cycles > BUDGET_CYCLES && late != 0xFFFF) late++;
+}
+
+void irq_service(void)
+{
+    static const uint8_t filler[8] = { 'U', 'U', 'U', 'U', 'U', 'U', 'U', 'U' };
+
+    while (flood_left) {
+        uint8_t n = (flood_left > sizeof(filler)) ? sizeof(filler) : (uint8_t)flood_left;
+        if (!uart_write_nb(filler, n)) return;
+        flood_left -= n;
+        if (!flood_left) uart_putc('\n');
+    }
+}
+
+// "tcb1 n N max_us N late N"
+void irq_report(void)
+{
+    uint16_t n, l;
+    uint32_t worst;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        n = ticks;
+        l = late;
+        worst = max_cycles;
+    }
+    uart_put_field_P(PSTR("tcb1 n "), n);
+    uart_put_field_P(PSTR(" max_us "), timer_us(worst));
+    uart_put_field_P(PSTR(" late "), l);
+    uart_putc('\n');
+}
+
+void irq_clear(void)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        ticks = 0;
+        late = 0;
+        max_cycles = 0;
+    }
+}
+
+void irq_flood(uint16_t n)
+{
+    flood_left = n;
+}
+
+#endif
@@ -0,0 +1,145 @@
+#include <stdint.h>
+#include "hal.h"
+
+#include "latency.h"
+
+#if LATENCY
+
+#include "timer.h"
+#include "uart.h"
+
+typedef enum {
+    LAT_H_DEBOUNCE,     // raw -> debounced
+    LAT_H_LOOP,         // debounced -> INPUT_WAITING
+    LAT_H_BUZZER,       // INPUT_WAITING -> TCA0 write
+    LAT_H_DISPLAY,      // INPUT_WAITING -> latch
+    LAT_H_TOTAL_BUZZER, // raw -> TCA0 write
+    LAT_H_TOTAL_DISPLAY,// raw -> latch
+    LAT_NUM_HIST
+} lat_hist_t;
+
+#define LAT_BINS 16     // bin k >= 2^k us, the last one open ended
+
+typedef struct {
+    uint16_t count;
+    uint16_t min_us;
+    uint16_t max_us;
+    uint16_t bins[LAT_BINS];
+} lat_stat_t;
+
+// From and to marks of each histogram
+static const uint8_t hist_marks[LAT_NUM_HIST][2] PROGMEM = {
+    { LAT_RAW,       LAT_DEBOUNCED },
+    { LAT_DEBOUNCED, LAT_INPUT },
+    { LAT_INPUT,     LAT_BUZZER },
+    { LAT_INPUT,     LAT_LATCH },
+    { LAT_RAW,       LAT_BUZZER },
+    { LAT_RAW,       LAT_LATCH },
+};
+static const char hist_names[LAT_NUM_HIST][7] PROGMEM = {
+    "deb", "loop", "buz", "disp", "t_buz", "t_disp"
+};
+
+#define LAT_IDLE    0xFF
+#define LAT_STALE   (100UL * (TIMER_CCMP + 1))      // glitch that never debounced
+
+static volatile uint8_t stage = LAT_IDLE;           // last mark seen
+static uint32_t stamps[LAT_NUM_MARKS];
+static lat_stat_t stats[LAT_NUM_HIST];
+
+// Report rows: header, one per histogram, then one per histogram bin
+#define ROW_HEAD        0
+#define ROW_BINS        (1 + LAT_NUM_HIST)
+#define ROW_END         (ROW_BINS + LAT_NUM_HIST * LAT_BINS)
+#define ROW_MAX_LEN     24      // "t_disp >=32768 65535\n"
+static uint8_t report_row = UART_ROW_NONE;
+
+void latency_init(void)
+{
+    hal_buttons_irq_init();
+}
+
+void latency_mark(uint8_t mark)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        uint32_t now = timer_cycles();
+        uint8_t accept;
+        if (mark == LAT_RAW) {
+            // Later bounces of the same press are ignored; a new press
+            // replaces one that never reached INPUT_WAITING
+            accept = stage == LAT_IDLE || stage == LAT_DEBOUNCED ||
+                     (stage == LAT_RAW && timer_span(stamps[LAT_RAW], now) > LAT_STALE);
+        } else {
+            accept = (stage == mark - 1);
+        }
+        if (accept) {
+            stamps[mark] = now;
+            stage = mark;
+        }
+    }
+}
+
+static void latency_bin(lat_stat_t *s, uint32_t from, uint32_t to)
+{
+    uint16_t us16 = timer_us(timer_span(from, to));
+    uint8_t bin = 0;
+
+    while (bin < LAT_BINS - 1 && (us16 >> (bin + 1))) bin++;
+    if (!s->count || us16 < s->min_us) s->min_us = us16;
+    if (us16 > s->max_us) s->max_us = us16;
+    if (s->count != 0xFFFF) s->count++;
+    if (s->bins[bin] != 0xFFFF) s->bins[bin]++;
+}
+
+void latency_clear(void)
+{
+    for (uint8_t h = 0; h < LAT_NUM_HIST; h++) {
+        stats[h].count = 0;
+        stats[h].min_us = 0;
+        stats[h].max_us = 0;
+        for (uint8_t k = 0; k < LAT_BINS; k++) stats[h].bins[k] = 0;
+    }
+}
+
+void latency_report(void)
+{
+    report_row = ROW_HEAD;
+}
+
+void latency_service(void)
+{
+    // The latch mark completes a press; bin it outside the ISRs
+    if (stage == LAT_LATCH) {
+        for (uint8_t h = 0; h < LAT_NUM_HIST; h++) {
+            uint8_t from = pgm_read_byte(&hist_marks[h][0]);
+            uint8_t to = pgm_read_byte(&hist_marks[h][1]);
+            latency_bin(&stats[h], stamps[from], stamps[to]);
+        }
+        stage = LAT_IDLE;
+    }
+
+    uint8_t row = uart_report_row(&report_row, ROW_END, ROW_MAX_LEN);
+    if (row == UART_ROW_NONE) return;
+
+    if (row == ROW_HEAD) {
+        uart_put_str_P(PSTR("stage n min_us max_us\n"));
+    } else if (row < ROW_BINS) {
+        lat_stat_t *s = &stats[row - 1];
+        uart_put_str_P(hist_names[row - 1]);
+        uart_put_field_P(PSTR(" "), s->count);
+        uart_put_field_P(PSTR(" "), s->min_us);
+        uart_put_field_P(PSTR(" "), s->max_us);
+        uart_putc('\n');
+    } else {
+        uint8_t h = (row - ROW_BINS) / LAT_BINS;
+        uint8_t k = (row - ROW_BINS) % LAT_BINS;
+        if (!stats[h].bins[k]) return;  // empty bin, skip the row
+        uart_put_str_P(hist_names[h]);
+        uart_put_str_P(PSTR(" >="));
+        uart_put_u16(k ? (uint16_t)1 << k : 0);
+        uart_put_field_P(PSTR(" "), stats[h].bins[k]);
+        uart_putc('\n');
+    }
+}
+
+#endif
@@ -0,0 +1,159 @@
+#include <stdint.h>
+#include "hal.h"
+
+#include "loopwatch.h"
+
+#if LOOPWATCH
+
+#include "timer.h"
+#include "uart.h"
+
+// Pass lengths in cycles: bin 0 < 2^8 (77 us), bin k >= 2^(k+7), the last
+// one open ended
+#define LW_BINS         16
+#define LW_BIN0_SHIFT   8
+#define LW_MAGIC        0x57A1u
+
+static uint8_t running = 0;             // a first beat has been seen
+static uint32_t last_beat;              // timer_cycles() at the last beat
+static volatile uint8_t beat_state;     // state of the pass in progress
+static volatile uint16_t beat_ms;       // uptime_ms at the last beat
+static volatile uint8_t stalled = 0;
+static volatile uint16_t stalls = 0;
+static uint32_t max_cycles = 0;
+static uint8_t max_state = 0;
+static uint16_t bins[LW_BINS];
+
+// Kept up to date by the tick while a stall lasts, so a watchdog reset
+// leaves the offender behind
+static struct {
+    uint16_t magic;
+    uint8_t state;
+    uint16_t ms;
+} stall_rec HAL_NOINIT;
+
+// Offender of the watchdog reset this boot followed, if any
+static uint8_t wdt_seen = 0;
+static uint8_t wdt_state;
+static uint16_t wdt_ms;
+
+// Report rows: longest pass, stalls, watchdog reset, then one per bin
+#define ROW_MAX         0
+#define ROW_STALLS      1
+#define ROW_WDT         2
+#define ROW_BINS        3
+#define ROW_END         (ROW_BINS + LW_BINS)
+#define ROW_MAX_LEN     28      // "loop max_us 65535 state 11\n"
+static uint8_t report_row = UART_ROW_NONE;
+
+void loopwatch_init(uint8_t reset_flags)
+{
+    if ((reset_flags & HAL_RESET_WATCHDOG) && stall_rec.magic == LW_MAGIC) {
+        wdt_seen = 1;
+        wdt_state = stall_rec.state;
+        wdt_ms = stall_rec.ms;
+    }
+    stall_rec.magic = 0;
+    hal_wdt_enable(LOOPWATCH_WDT_MS);
+}
+
+void loopwatch_beat(uint8_t state)
+{
+    uint32_t now;
+
+    hal_wdt_reset();
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        now = timer_cycles();
+        beat_ms = uptime_ms;
+        if (stalled) {
+            stalled = 0;
+            stall_rec.magic = 0;
+        }
+    }
+
+    uint32_t period = timer_span(last_beat, now);
+    last_beat = now;
+    if (running) {
+        if (period > max_cycles) {
+            max_cycles = period;
+            max_state = beat_state;
+        }
+        uint8_t bin = 0;
+        for (uint32_t p = period >> LW_BIN0_SHIFT; p && bin < LW_BINS - 1; p >>= 1) bin++;
+        if (bins[bin] != 0xFFFF) bins[bin]++;
+    }
+    running = 1;
+    beat_state = state;
+}
+
+void loopwatch_tick(void)
+{
+    uint16_t since = uptime_ms - beat_ms;
+    if (!running || since < LOOPWATCH_STALL_MS) return;
+    if (!stalled) {
+        stalled = 1;
+        if (stalls != 0xFFFF) stalls++;
+        stall_rec.state = beat_state;
+        stall_rec.magic = LW_MAGIC;
+    }
+    stall_rec.ms = since;
+}
+
+void loopwatch_clear(void)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        max_cycles = 0;
+        max_state = 0;
+        stalls = 0;
+        wdt_seen = 0;
+        for (uint8_t k = 0; k < LW_BINS; k++) bins[k] = 0;
+    }
+}
+
+void loopwatch_report(void)
+{
+    report_row = ROW_MAX;
+}
+
+// Lower edge of bin k, in us while that fits in 16 bits, else in ms
+static void put_edge(uint8_t k)
+{
+    uint32_t cycles = k ? 1UL << (k + LW_BIN0_SHIFT - 1) : 0;
+    uint16_t us = timer_us(cycles);
+    if (us != 0xFFFF) {
+        uart_put_field_P(PSTR("loop >="), us);
+        uart_put_str_P(PSTR(" us"));
+    } else {
+        uart_put_field_P(PSTR("loop >="), (uint16_t)(cycles / (TIMER_CCMP + 1)));
+        uart_put_str_P(PSTR(" ms"));
+    }
+}
+
+void loopwatch_service(void)
+{
+    uint8_t row = uart_report_row(&report_row, ROW_END, ROW_MAX_LEN);
+    if (row == UART_ROW_NONE) return;
+
+    if (row == ROW_MAX) {
+        uart_put_field_P(PSTR("loop max_us "), timer_us(max_cycles));
+        uart_put_field_P(PSTR(" state "), max_state);
+    } else if (row == ROW_STALLS) {
+        uint16_t n;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            n = stalls;
+        }
+        uart_put_field_P(PSTR("stalls "), n);
+    } else if (row == ROW_WDT) {
+        if (!wdt_seen) return;
+        uart_put_field_P(PSTR("wdt state "), wdt_state);
+        uart_put_field_P(PSTR(" ms "), wdt_ms);
+    } else {
+        uint8_t k = row - ROW_BINS;
+        if (!bins[k]) return;           // empty bin, skip the row
+        put_edge(k);
+        uart_put_field_P(PSTR(" "), bins[k]);
+    }
+    uart_putc('\n');
+}
+
+#endif
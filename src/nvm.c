@@ -0,0 +1,11 @@
+#include <stdint.h>
+#include "hal.h"
+#include "nvm.h"
+
+void nvm_eeprom_write_page(uint8_t addr, const uint8_t *data) {
+    // Writing through the mapped address fills the page buffer
+    for (uint8_t k = 0; k < NVM_EEPROM_PAGE; k++) {
+        hal_eeprom_buffer_write(addr + k, data[k]);
+    }
+    hal_eeprom_page_erase_write();
+}//nvm_eeprom_write_page
@@ -0,0 +1,141 @@
+#include <stdint.h>
+#include "hal.h"
+
+#include "profile.h"
+
+#if PROFILE
+
+#include "timer.h"
+#include "uart.h"
+
+typedef struct {
+    uint16_t count;
+    uint16_t min;
+    uint16_t max;
+    uint32_t sum;
+} prof_isr_stat_t;
+
+typedef struct {
+    uint16_t entries;
+    uint16_t max_ms;
+    uint32_t total_ms;
+    uint32_t loops;
+} prof_state_stat_t;
+
+static volatile prof_isr_stat_t isr_stat[PROF_NUM_ISR];
+static prof_state_stat_t state_stat[PROF_NUM_STATES];
+static uint8_t cur_state = 0xFF;
+static uint16_t entered_ms;
+static uint16_t last_ms;
+
+static const char isr_names[PROF_NUM_ISR][5] PROGMEM = { "TCB0", "TCB1", "SPI0", "RXC", "DRE", "CCL" };
+
+// Report rows: ISR header, one per ISR, state header, one per state
+#define ROW_ISR_HEAD    0
+#define ROW_STATE_HEAD  (1 + PROF_NUM_ISR)
+#define ROW_END         (ROW_STATE_HEAD + 1 + PROF_NUM_STATES)
+#define ROW_MAX_LEN     30      // "TCB0 65535 65535 65535 65535\n", fits the TX ring
+static uint8_t report_row = UART_ROW_NONE;
+
+void profile_isr_exit(uint8_t isr, uint16_t start)
+{
+    uint16_t now = hal_tcb_count(0);
+    uint16_t cycles = (now >= start) ? now - start : (uint16_t)(now + (TIMER_CCMP + 1) - start);
+    volatile prof_isr_stat_t *s = &isr_stat[isr];
+
+    if (s->count == 0xFFFF) return;     // saturated, keep the average meaningful
+    if (!s->count || cycles < s->min) s->min = cycles;
+    if (cycles > s->max) s->max = cycles;
+    s->sum += cycles;
+    s->count++;
+}
+
+void profile_loop(uint8_t state)
+{
+    uint16_t now;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        now = uptime_ms;
+    }
+
+    // Time since the last pass belongs to the state that pass was in, so
+    // the state still running is counted too
+    if (cur_state < PROF_NUM_STATES) state_stat[cur_state].total_ms += (uint16_t)(now - last_ms);
+    last_ms = now;
+
+    if (state != cur_state) {
+        if (cur_state < PROF_NUM_STATES) {
+            uint16_t dwell = now - entered_ms;
+            if (dwell > state_stat[cur_state].max_ms) state_stat[cur_state].max_ms = dwell;
+        }
+        cur_state = state;
+        entered_ms = now;
+        if (state_stat[state].entries != 0xFFFF) state_stat[state].entries++;
+    }
+    state_stat[state].loops++;
+}
+
+void profile_clear(void)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        for (uint8_t k = 0; k < PROF_NUM_ISR; k++) {
+            isr_stat[k].count = 0;
+            isr_stat[k].min = 0;
+            isr_stat[k].max = 0;
+            isr_stat[k].sum = 0;
+        }
+    }
+    for (uint8_t k = 0; k < PROF_NUM_STATES; k++) {
+        state_stat[k].entries = 0;
+        state_stat[k].max_ms = 0;
+        state_stat[k].total_ms = 0;
+        state_stat[k].loops = 0;
+    }
+    cur_state = 0xFF;
+}
+
+void profile_report(void)
+{
+    report_row = ROW_ISR_HEAD;
+}
+
+static uint16_t clamp16(uint32_t v)
+{
+    return (v > 0xFFFF) ? 0xFFFF : (uint16_t)v;
+}
+
+void profile_service(void)
+{
+    uint8_t row = uart_report_row(&report_row, ROW_END, ROW_MAX_LEN);
+    if (row == UART_ROW_NONE) return;
+
+    if (row == ROW_ISR_HEAD) {
+        uart_put_str_P(PSTR("isr n min avg max\n"));
+    } else if (row < ROW_STATE_HEAD) {
+        uint8_t k = row - 1;
+        prof_isr_stat_t s;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            s = isr_stat[k];
+        }
+        uart_put_str_P(isr_names[k]);
+        uart_put_field_P(PSTR(" "), s.count);
+        uart_put_field_P(PSTR(" "), s.min);
+        uart_put_field_P(PSTR(" "), s.count ? (uint16_t)(s.sum / s.count) : 0);
+        uart_put_field_P(PSTR(" "), s.max);
+        uart_putc('\n');
+    } else if (row == ROW_STATE_HEAD) {
+        uart_put_str_P(PSTR("state n avg_ms max_ms loops/s\n"));
+    } else {
+        uint8_t k = row - ROW_STATE_HEAD - 1;
+        prof_state_stat_t *s = &state_stat[k];
+        if (!s->entries) return;        // never entered, skip the row
+        uart_put_u16(k);
+        uart_put_field_P(PSTR(" "), s->entries);
+        uart_put_field_P(PSTR(" "), clamp16(s->total_ms / s->entries));
+        uart_put_field_P(PSTR(" "), s->max_ms);
+        uart_put_field_P(PSTR(" "), s->total_ms ? clamp16(s->loops / s->total_ms * 1000 +
+                                                          s->loops % s->total_ms * 1000 / s->total_ms) : 0);
+        uart_putc('\n');
+    }
+}
+
+#endif
@@ -28,10 +28,3 @@ uint8_t sequencing_next_step(void) {
     return lfsr_state & 0x03u;
 }
 
-void sequencing_generate_sequence(uint32_t start_state, uint8_t length, uint8_t *steps_array) {
-    sequencing_restore_state(start_state);
-    for (uint8_t j = 0; j < length; j++) {
-        steps_array[j] = sequencing_next_step();
-    }
-}
-
@@ -0,0 +1,70 @@
+#include <stdint.h>
+#include "hal.h"
+
+#include "stackmon.h"
+
+#if STACKMON
+
+#ifdef HAL_HOST
+#error "STACKMON needs the AVR memory map"
+#endif
+
+#include "uart.h"
+
+// Linker symbols (avr-libc default linker script)
+extern uint8_t __data_start, __data_end;
+extern uint8_t __bss_start, __bss_end;
+extern uint8_t _end;            // end of all static RAM
+extern uint8_t __stack;         // RAMEND, initial SP
+
+static uint8_t *watermark;      // lowest byte the stack is known to have reached
+
+// Runs before __do_copy_data/__do_clear_bss and before SP and r1 are set
+// up, so it is plain asm with no stack and no zero register. SP still
+// holds its reset value RAMEND and nothing is on the stack yet.
+__attribute__((naked, used, section(".init1")))
+static void stackmon_paint(void)
+{
+    __asm__ volatile (
+        "    ldi r30, lo8(_end)      \n"
+        "    ldi r31, hi8(_end)      \n"
+        "    ldi r24, %0             \n"
+        "    ldi r25, hi8(__stack)   \n"
+        "    rjmp 2f                 \n"
+        "1:  st Z+, r24              \n"
+        "2:  cpi r30, lo8(__stack)   \n"
+        "    cpc r31, r25            \n"
+        "    brlo 1b                 \n"
+        "    breq 1b                 \n"
+        :: "i" (STACK_CANARY) : "r24", "r25", "r30", "r31", "memory"
+    );
+}
+
+void stackmon_service(void)
+{
+    if (!watermark) watermark = (uint8_t *)SP;
+
+    // Two paint bytes in a row end the scan, so a pushed value that happens
+    // to equal STACK_CANARY does not hide deeper use
+    while (watermark > &_end &&
+           (watermark[-1] != STACK_CANARY ||
+            (watermark - 1 > &_end && watermark[-2] != STACK_CANARY))) {
+        watermark--;
+    }
+}
+
+// "data <n> bss <n>\nfree <n> min <n>\n"
+void stackmon_report(void)
+{
+    stackmon_service();
+    uint16_t free_now = (uint16_t)((uint8_t *)SP - &_end);
+    uint16_t free_min = (uint16_t)(watermark - &_end);
+
+    uart_put_field_P(PSTR("data "), (uint16_t)(&__data_end - &__data_start));
+    uart_put_field_P(PSTR(" bss "), (uint16_t)(&__bss_end - &__bss_start));
+    uart_put_field_P(PSTR("\nfree "), free_now);
+    uart_put_field_P(PSTR(" min "), free_min);
+    uart_putc('\n');
+}
+
+#endif
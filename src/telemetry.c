@@ -0,0 +1,86 @@
+#include <stdint.h>
+#include "hal.h"
+
+#include "telemetry.h"
+#include "timer.h"
+#include "uart.h"
+
+#define TLM_RECORD_LEN 6
+#define TLM_FRAME_MAX  (TLM_RECORD_MAX + 2)     // COBS overhead byte + 0x00 delimiter
+
+volatile uint8_t telemetry_enabled = 0;
+static volatile uint16_t dropped = 0;
+
+// CRC-8, poly 0x07, init 0x00, nibble table (2 lookups per byte)
+static const uint8_t crc8_nibble[16] PROGMEM = {
+    0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15,
+    0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D
+};
+
+static uint8_t crc8(const uint8_t *p, uint8_t n) {
+    uint8_t crc = 0;
+    while (n--) {
+        crc ^= *p++;
+        crc = (crc << 4) ^ pgm_read_byte(&crc8_nibble[crc >> 4]);
+        crc = (crc << 4) ^ pgm_read_byte(&crc8_nibble[crc >> 4]);
+    }
+    return crc;
+}
+
+// COBS encode n (< 254) bytes, appending the 0x00 delimiter. Returns frame length.
+static uint8_t cobs_encode(const uint8_t *in, uint8_t n, uint8_t *out) {
+    uint8_t code_pos = 0;
+    uint8_t code = 1;
+    uint8_t o = 1;
+
+    for (uint8_t k = 0; k < n; k++) {
+        if (in[k] == 0) {
+            out[code_pos] = code;
+            code_pos = o++;
+            code = 1;
+        } else {
+            out[o++] = in[k];
+            code++;
+        }
+    }
+    out[code_pos] = code;
+    out[o++] = 0;
+    return o;
+}
+
+uint8_t telemetry_send(uint8_t *rec, uint8_t n) {
+    uint8_t frame[TLM_FRAME_MAX];
+
+    rec[n] = crc8(rec, n);
+    return uart_write_nb(frame, cobs_encode(rec, n + 1, frame));
+}
+
+void telemetry_emit_event(uint8_t type, uint16_t value) {
+    uint8_t rec[TLM_RECORD_LEN];
+    uint16_t t;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        t = uptime_ms;
+    }
+
+    rec[0] = type;
+    rec[1] = (uint8_t)value;
+    rec[2] = (uint8_t)(value >> 8);
+    rec[3] = (uint8_t)t;
+    rec[4] = (uint8_t)(t >> 8);
+
+    if (!telemetry_send(rec, TLM_RECORD_LEN - 1)) {
+        // Events come from both the RX ISR and the main loop
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            dropped++;
+        }
+    }
+}
+
+uint16_t telemetry_dropped(void) {
+    uint16_t n;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        n = dropped;
+    }
+    return n;
+}
@@ -1,19 +1,55 @@
+#include "hal.h"
 #include "timer.h"
-#include <avr/io.h>
-#include <avr/interrupt.h>
+#include "profile.h"
+#include "loopwatch.h"
 
 volatile uint16_t elapsed_time = 0;
+volatile uint16_t uptime_ms = 0;       // free running, never reset
 
 void timer_init(void) {
     // configure TCB0 for a periodic interrupt every 1ms
-    TCB0.CTRLB = TCB_CNTMODE_INT_gc;    // Configure TCB0 in periodic interrupt mode
-    TCB0.CCMP = 3333;                   // Set interval for 1ms (3333 clocks @ 3.3 MHz)
-    TCB0.INTCTRL = TCB_CAPT_bm;         // CAPT interrupt enable
-    TCB0.CTRLA = TCB_ENABLE_bm;         // Enable TCB0
-    }
+    hal_tcb_init_periodic(0, TIMER_CCMP, 0);
+}
+
+uint32_t timer_cycles(void) {
+    uint16_t ms = uptime_ms;
+    uint16_t cnt = hal_tcb_count(0);
+    // TCB0 wrapped but its ISR has not run yet
+    if (hal_tcb_pending(0) && cnt < (TIMER_CCMP + 1) / 2) ms++;
+    return (uint32_t)ms * (TIMER_CCMP + 1) + cnt;
+}
+
+uint32_t timer_span(uint32_t from, uint32_t to) {
+    return (to >= from) ? to - from : to + TIMER_WRAP - from;
+}
+
+uint16_t timer_us(uint32_t cycles) {
+    uint32_t ms = cycles / (TIMER_CCMP + 1);
+    if (ms >= 66) return 0xFFFF;
+    uint32_t us = ms * 1000 + (cycles % (TIMER_CCMP + 1)) * 1000 / (TIMER_CCMP + 1);
+    return (us > 0xFFFF) ? 0xFFFF : (uint16_t)us;
+}
 
 // periodic interrupt every 1ms
 ISR(TCB0_INT_vect) { 
-    elapsed_time++;
-    TCB0.INTFLAGS = TCB_CAPT_bm;
+    PROFILE_ISR_ENTER();
+    // TCB1 runs at level 1 and must never see these half updated
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        elapsed_time++;
+        uptime_ms++;
+    }
+    loopwatch_tick();
+#if TIMER_TICK_REM
+    // Spread the cycles a whole-kHz top misses over the second
+    static uint16_t tick_frac = 0;
+    tick_frac += TIMER_TICK_REM;
+    if (tick_frac >= TIMER_TICK_HZ) {
+        tick_frac -= TIMER_TICK_HZ;
+        hal_tcb_set_top(0, TIMER_CCMP + 1);
+    } else {
+        hal_tcb_set_top(0, TIMER_CCMP);
+    }
+#endif
+    hal_tcb_ack(0);
+    PROFILE_ISR_EXIT(PROF_TCB0);
 }
@@ -0,0 +1,79 @@
+#include <stdint.h>
+#include "hal.h"
+
+#include "tlog.h"
+
+#if TLOG
+
+#include "telemetry.h"
+#include "timer.h"
+#include "uart.h"
+
+typedef struct {
+    uint16_t token;
+    uint16_t t;
+    uint16_t arg[2];
+    uint8_t nargs;
+} tlog_rec_t;
+
+#define TLOG_RING_SIZE 16               // must be a power of two
+#define TLOG_RING_MASK (TLOG_RING_SIZE - 1)
+#define TLOG_FRAME_MAX (TLM_RECORD_MAX + 2)
+_Static_assert(6 + 2 * 2 <= TLM_RECORD_MAX, "two-argument record too long for telemetry_send()");
+
+volatile uint8_t tlog_enabled = 0;
+static tlog_rec_t ring[TLOG_RING_SIZE];
+static volatile uint8_t ring_head = 0;
+static volatile uint8_t ring_tail = 0;
+static volatile uint16_t dropped = 0;
+
+void tlog_push(uint16_t token, uint8_t nargs, uint16_t a, uint16_t b)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        uint8_t head = ring_head;
+        uint8_t next = (head + 1) & TLOG_RING_MASK;
+        if (next == ring_tail) {
+            if (dropped != 0xFFFF) dropped++;
+        } else {
+            tlog_rec_t *r = &ring[head];
+            r->token = token;
+            r->t = uptime_ms;
+            r->arg[0] = a;
+            r->arg[1] = b;
+            r->nargs = nargs;
+            ring_head = next;
+        }
+    }
+}
+
+void tlog_service(void)
+{
+    uint8_t tail = ring_tail;
+    if (tail == ring_head || uart_tx_free() < TLOG_FRAME_MAX) return;
+
+    // Only the game loop removes records, so this one stays put
+    const tlog_rec_t *r = &ring[tail];
+    uint8_t rec[TLM_RECORD_MAX];
+    uint8_t n = 0;
+    rec[n++] = TLOG_TYPE + r->nargs;
+    rec[n++] = (uint8_t)r->token;
+    rec[n++] = (uint8_t)(r->token >> 8);
+    rec[n++] = (uint8_t)r->t;
+    rec[n++] = (uint8_t)(r->t >> 8);
+    for (uint8_t k = 0; k < r->nargs; k++) {
+        rec[n++] = (uint8_t)r->arg[k];
+        rec[n++] = (uint8_t)(r->arg[k] >> 8);
+    }
+    if (telemetry_send(rec, n)) ring_tail = (tail + 1) & TLOG_RING_MASK;
+}
+
+uint16_t tlog_dropped(void)
+{
+    uint16_t n;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        n = dropped;
+    }
+    return n;
+}
+
+#endif
@@ -1,38 +1,108 @@
-#include <avr/io.h>
-#include <avr/interrupt.h>
 #include <stdint.h>
-#include <stdio.h>
+#include "hal.h"
 #include "uart.h"
 #include "buzzer.h"
+#include "telemetry.h"
+#include "profile.h"
+#include "input.h"
+#include "timer.h"
 
-volatile int8_t uart_game_input = -1;
 volatile uint8_t uart_input_enabled = 0;
+volatile uint8_t uart_reset_request = 0;
 
-static int stdio_putchar(char c, FILE *stream);
-static int stdio_getchar(FILE *stream);
-static FILE stdio = FDEV_SETUP_STREAM(stdio_putchar, stdio_getchar, _FDEV_SETUP_RW);
+// Supported rates, all register values folded at compile time
+typedef struct {
+    uint32_t rate;
+    uint16_t baud;
+    uint8_t clk2x;
+} uart_rate_t;
+
+#define UART_RATE(r) { r, UART_BAUD_REG(r), UART_USE_CLK2X(r) }
+
+static const uart_rate_t uart_rates[] PROGMEM = {
+    UART_RATE(9600UL),
+    UART_RATE(19200UL),
+    UART_RATE(38400UL),
+    UART_RATE(57600UL),
+    UART_RATE(115200UL),
+    UART_RATE(230400UL),
+    UART_RATE(250000UL),
+    UART_RATE(500000UL),
+};
+#define UART_NUM_RATES (sizeof(uart_rates) / sizeof(uart_rates[0]))
+
+_Static_assert(UART_RATE_OK(UART_DEFAULT_BAUD), "default baud not reachable at F_CPU");
+
+#define UART_NO_PENDING 0xFF
+static uint8_t rate_index = 0;
+static volatile uint8_t pending_index = UART_NO_PENDING;
+
+// Interrupt-driven TX ring, drained by USART0_DRE_vect
+#define UART_TX_SIZE 32                 // must be a power of two
+#define UART_TX_MASK (UART_TX_SIZE - 1)
+static volatile uint8_t tx_buf[UART_TX_SIZE];
+static volatile uint8_t tx_head = 0;
+static volatile uint8_t tx_tail = 0;
+
+// Name entry RX ring, filled by the RX ISR
+#define UART_RX_SIZE 16                 // must be a power of two
+#define UART_RX_MASK (UART_RX_SIZE - 1)
+static volatile uint8_t rx_buf[UART_RX_SIZE];
+static volatile uint8_t rx_head = 0;
+static volatile uint8_t rx_tail = 0;
+static volatile uint8_t name_entry = 0;
+
+// Command line capture (filled by the RX ISR). A '!' that is not followed
+// by a command line within UART_CMD_MAX - 1 bytes, or with a gap of
+// UART_CMD_TIMEOUT_MS, was not a command: the capture is aborted and
+// uart_service() hands the bytes on as keys, in order. Keys that arrive
+// before it has caught up queue behind them, up to UART_CMD_BUF bytes.
+#define UART_CMD_MAX 16                 // longest command line, with its '\0'
+#define UART_CMD_BUF (UART_CMD_MAX + 8)
+#define UART_CMD_TIMEOUT_MS 1000
+#define CMD_IDLE    0
+#define CMD_CAPTURE 1
+#define CMD_READY   2
+#define CMD_ABORT   3
+static char cmd_buf[UART_CMD_BUF];
+static uint8_t cmd_len = 0;
+static uint8_t cmd_pos = 0;             // next byte to hand on after an abort
+static volatile uint16_t cmd_ms;        // uptime_ms at the last captured byte
+static volatile uint8_t cmd_state = CMD_IDLE;
+
+static void uart_apply_rate(uint8_t index)
+{
+    uint16_t baud = pgm_read_word(&uart_rates[index].baud);
+    uint8_t clk2x = pgm_read_byte(&uart_rates[index].clk2x);
+
+    hal_uart_set_baud(baud, clk2x);
+    rate_index = index;
+}
 
 void uart_init()
 {
-    PORTB.DIRSET = PIN2_bm;
-    USART0.BAUD = 1389;
-    USART0.CTRLB = USART_RXEN_bm | USART_TXEN_bm;
-    USART0.CTRLA = USART_RXCIE_bm;
-    stdout = &stdio;
-    stdin = &stdio;
+    uart_apply_rate(0);                 // UART_DEFAULT_BAUD
+    hal_uart_init();                    // TX pin, RX interrupt
 }
 
-ISR(USART0_RXC_vect)
+// Octave, RESET and game keys
+static void uart_key(uint8_t rx)
 {
-    uint8_t rx = USART0.RXDATAL;
-    
     // Always handle octave changes (INC FREQ / DEC FREQ)
     if (rx == ',' || rx == 'k') {
         increase_octave();
+        telemetry_emit(TLM_OCTAVE, (uint8_t)buzzer_get_octave());
         return;
     }
     if (rx == '.' || rx == 'l') {
         decrease_octave();
+        telemetry_emit(TLM_OCTAVE, (uint8_t)buzzer_get_octave());
+        return;
+    }
+
+    // RESET is taken in any state; the game loop acts on it
+    if (rx == '0' || rx == 'p') {
+        uart_reset_request = 1;
         return;
     }
     
@@ -40,32 +110,222 @@ ISR(USART0_RXC_vect)
     if (!uart_input_enabled) return;
     
     // Only accept valid game inputs - ignore everything else
-    if (rx == '1' || rx == 'q') uart_game_input = 0;
-    else if (rx == '2' || rx == 'w') uart_game_input = 1;
-    else if (rx == '3' || rx == 'e') uart_game_input = 2;
-    else if (rx == '4' || rx == 'r') uart_game_input = 3;
+    if (rx == '1' || rx == 'q') input_push(INPUT_SRC_UART, 0, INPUT_PRESS);
+    else if (rx == '2' || rx == 'w') input_push(INPUT_SRC_UART, 1, INPUT_PRESS);
+    else if (rx == '3' || rx == 'e') input_push(INPUT_SRC_UART, 2, INPUT_PRESS);
+    else if (rx == '4' || rx == 'r') input_push(INPUT_SRC_UART, 3, INPUT_PRESS);
     // Invalid characters are automatically discarded - no blocking!
 }
 
+static inline void uart_rx(uint8_t rx)
+{
+    // Name entry takes precedence over everything else
+    if (name_entry) {
+        uint8_t next = (rx_head + 1) & UART_RX_MASK;
+        if (next != rx_tail) {
+            rx_buf[rx_head] = rx;
+            rx_head = next;
+        }
+        return;
+    }
+
+    // Command line in progress: swallow everything up to the newline
+    if (cmd_state == CMD_CAPTURE) {
+        if (rx == '\n' || rx == '\r') {
+            cmd_buf[cmd_len] = '\0';
+            cmd_state = CMD_READY;
+        } else if (cmd_len < UART_CMD_MAX - 1) {
+            cmd_buf[cmd_len++] = rx;
+            cmd_ms = uptime_ms;
+        } else {
+            cmd_buf[cmd_len++] = rx;    // too long for a command
+            cmd_pos = 0;
+            cmd_state = CMD_ABORT;
+        }
+        return;
+    }
+    if (cmd_state == CMD_ABORT) {
+        if (cmd_len < UART_CMD_BUF) cmd_buf[cmd_len++] = rx;
+        return;
+    }
+    if (rx == '!' && cmd_state == CMD_IDLE) {
+        cmd_len = 0;
+        cmd_ms = uptime_ms;
+        cmd_state = CMD_CAPTURE;
+        return;
+    }
+
+    uart_key(rx);
+}
+
+ISR(USART0_RXC_vect)
+{
+    PROFILE_ISR_ENTER();
+    uart_rx(hal_uart_rx_byte());
+    PROFILE_ISR_EXIT(PROF_RXC);
+}
+
 uint8_t uart_getc(void)
 {
-    while (!(USART0.STATUS & USART_RXCIF_bm));
-    return USART0.RXDATAL;
+    while (!hal_uart_rx_ready());
+    return hal_uart_rx_byte();
 }
 
 void uart_putc(uint8_t c)
 {
-    while (!(USART0.STATUS & USART_DREIF_bm));
-    USART0.TXDATAL = c;
+    while (!uart_write_nb(&c, 1));      // only waits while the ring is full
+}
+
+ISR(USART0_DRE_vect)
+{
+    PROFILE_ISR_ENTER();
+    hal_uart_tx_byte(tx_buf[tx_tail]);
+    tx_tail = (tx_tail + 1) & UART_TX_MASK;
+    if (tx_tail == tx_head) hal_uart_dre_irq(0);
+    PROFILE_ISR_EXIT(PROF_DRE);
+}
+
+uint8_t uart_tx_free(void)
+{
+    return (UART_TX_SIZE - 1) - ((uint8_t)(tx_head - tx_tail) & UART_TX_MASK);
+}
+
+uint8_t uart_write_nb(const uint8_t *buf, uint8_t n)
+{
+    uint8_t ok = 0;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (uart_tx_free() >= n) {
+            uint8_t head = tx_head;
+            while (n--) {
+                tx_buf[head] = *buf++;
+                head = (head + 1) & UART_TX_MASK;
+            }
+            tx_head = head;
+            hal_uart_dre_irq(1);
+            ok = 1;
+        }
+    }
+    return ok;
+}
+
+void uart_name_entry(uint8_t enable)
+{
+    rx_tail = rx_head;                  // discard anything stale
+    name_entry = enable;
 }
 
-static int stdio_putchar(char c, FILE *stream)
+int16_t uart_name_getc(void)
 {
-    uart_putc(c);
+    if (rx_tail == rx_head) return -1;
+    uint8_t c = rx_buf[rx_tail];
+    rx_tail = (rx_tail + 1) & UART_RX_MASK;
     return c;
 }
 
-static int stdio_getchar(FILE *stream)
+uint8_t uart_request_baud(uint32_t rate, const char *ack)
 {
-    return uart_getc();
+    for (uint8_t k = 0; k < UART_NUM_RATES; k++) {
+        if (pgm_read_dword(&uart_rates[k].rate) != rate) continue;
+        if (pgm_read_word(&uart_rates[k].baud) < 64) return 0;   // not reachable at F_CPU
+
+        // TXCIF is set once the shifter empties with nothing queued. Any
+        // earlier output may finish (and set it) until the ack is in the
+        // ring; after that the ring keeps the shifter fed until the ack's
+        // last stop bit, so clearing it here leaves no stale flag behind
+        uart_put_str_P(ack);
+        hal_uart_txc_clear();
+        pending_index = k;
+        return 1;
+    }
+    return 0;
+}
+
+uint32_t uart_current_baud(void)
+{
+    return pgm_read_dword(&uart_rates[rate_index].rate);
+}
+
+void uart_service(void)
+{
+    if (cmd_state == CMD_CAPTURE) {
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            if (cmd_state == CMD_CAPTURE &&
+                (uint16_t)(uptime_ms - cmd_ms) >= UART_CMD_TIMEOUT_MS) {
+                cmd_pos = 0;
+                cmd_state = CMD_ABORT;
+            }
+        }
+    }
+    // One byte per atomic block, so the RX ISR can queue more behind them
+    while (cmd_state == CMD_ABORT) {
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            if (cmd_pos < cmd_len) uart_key(cmd_buf[cmd_pos++]);
+            else cmd_state = CMD_IDLE;
+        }
+    }
+
+    if (pending_index != UART_NO_PENDING && tx_head == tx_tail &&
+        hal_uart_txc()) {
+        uart_apply_rate(pending_index);
+        pending_index = UART_NO_PENDING;
+    }
+}
+
+const char *uart_cmd_line(void)
+{
+    return (cmd_state == CMD_READY) ? cmd_buf : 0;
+}
+
+void uart_cmd_release(void)
+{
+    cmd_state = CMD_IDLE;
+}
+
+void uart_put_str_P(const char *s)
+{
+    char c;
+    while ((c = pgm_read_byte(s++))) uart_putc(c);
+}
+
+void uart_put_u16(uint16_t v)
+{
+    static const uint16_t pow10[4] PROGMEM = {10000, 1000, 100, 10};
+    uint8_t started = 0;
+
+    for (uint8_t k = 0; k < 4; k++) {
+        uint16_t p = pgm_read_word(&pow10[k]);
+        uint8_t digit = 0;
+        while (v >= p) {
+            v -= p;
+            digit++;
+        }
+        if (digit || started) {
+            uart_putc('0' + digit);
+            started = 1;
+        }
+    }
+    uart_putc('0' + (uint8_t)v);
+}
+
+void uart_put_field_P(const char *label, uint16_t v)
+{
+    uart_put_str_P(label);
+    uart_put_u16(v);
+}
+
+uint8_t uart_report_row(uint8_t *next, uint8_t rows, uint8_t max_len)
+{
+    if (*next == UART_ROW_NONE || uart_tx_free() < max_len) return UART_ROW_NONE;
+    uint8_t row = (*next)++;
+    if (*next >= rows) *next = UART_ROW_NONE;
+    return row;
+}
+
+void uart_put_hex32(uint32_t v)
+{
+    for (uint8_t k = 0; k < 8; k++) {
+        uint8_t nibble = (uint8_t)(v >> 28);
+        uart_putc(nibble < 10 ? '0' + nibble : 'A' - 10 + nibble);
+        v <<= 4;
+    }
 }
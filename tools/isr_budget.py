@@ -0,0 +1,459 @@
+#!/usr/bin/env python3
+"""Static worst-case cycle and stack analysis of the firmware's ISRs.
+
+Usage:
+    isr_budget.py firmware.elf [--budget TCB0_INT=3333 ...] [--loop fn=N ...]
+                               [--level1 TCB1_INT]
+    isr_budget.py --listing firmware.S ...    (avr-objdump -d output, as in
+                                               demos/studio-demo3/firmware.S)
+
+Every function in the disassembly is split into instructions and a control
+flow graph. Cycle counts are the AVRxt (tinyAVR 2-series) timings from the
+AVR instruction set manual; loads are charged one extra cycle as if they hit
+memory-mapped flash (const data lives there on this part). A function's
+worst case is the longest path from its entry to a ret/reti/tail jump,
+counting each call as the callee's own worst case plus the call and ret.
+
+Loops cannot be bounded from the listing, so a function that contains one
+must be given --loop fn=N: every instruction inside a loop of fn is then
+charged N times. Stack depth does not need loop bounds: it is the deepest
+point reached through push, rcall .+0, frame allocation (sbiw/subi on Y
+written back to SP) and calls, each call adding the 2-byte return address.
+icall/ijmp targets are unknown; their stack is bounded by the deepest
+function in the image, and they are an error inside an ISR's call tree.
+
+Each ISR is charged the interrupt response (PC push and vector jmp) on top
+of its body, and 2 bytes of stack for the pushed PC. Level 0 ISRs do not
+nest. --level1 names the one vector CPUINT runs at level 1 (include/irq.h):
+it can interrupt any level 0 ISR, once at most while that ISR is shorter
+than the level 1 period. Each level 0 ISR's budget is therefore checked
+against its own worst case plus the level 1 ISR's ("nested"), and the
+worst-case total stack is the deepest main() call tree plus the deepest
+level 0 ISR plus the level 1 ISR. Without --level1 nothing nests, and the
+total is main() plus the deepest ISR.
+
+Exits with status 1 when an ISR exceeds its --budget, a --stack budget is
+exceeded, or a budgeted ISR cannot be bounded.
+"""
+import argparse
+import re
+import subprocess
+import sys
+
+# ATtiny1626 vector numbers (iotn1626.h)
+VECTORS = {
+    1: "NMI", 2: "BOD_VLM", 3: "PORTA_PORT", 4: "PORTB_PORT", 5: "PORTC_PORT",
+    6: "RTC_CNT", 7: "RTC_PIT", 8: "TCA0_OVF", 9: "TCA0_HUNF", 10: "TCA0_CMP0",
+    11: "TCA0_CMP1", 12: "TCA0_CMP2", 13: "TCB0_INT", 14: "TCB1_INT",
+    15: "TWI0_TWIS", 16: "TWI0_TWIM", 17: "SPI0_INT", 18: "USART0_RXC",
+    19: "USART0_DRE", 20: "USART0_TXC", 21: "USART1_RXC", 22: "USART1_DRE",
+    23: "USART1_TXC", 24: "AC0_AC", 25: "ADC0_ERROR", 26: "ADC0_RESRDY",
+    27: "ADC0_SAMPRDY", 28: "CCL_CCL", 29: "NVMCTRL_EE",
+}
+
+IRQ_ENTRY_CYCLES = 2 + 3        # PC push, then jmp in the vector table
+IRQ_ENTRY_STACK = 2             # 16-bit PC
+CALL_STACK = 2
+
+# libgcc routines with loops, bounded by their operand width
+LIBGCC_LOOPS = {"__udivmodqi4": 9, "__udivmodhi4": 17, "__udivmodsi4": 33}
+
+CYCLES = {
+    "adiw": 2, "sbiw": 2, "mul": 2, "muls": 2, "mulsu": 2,
+    "fmul": 2, "fmuls": 2, "fmulsu": 2,
+    "ld": 3, "ldd": 3, "lds": 4, "lpm": 3, "elpm": 3,
+    "st": 1, "std": 1, "sts": 2, "pop": 2, "push": 1,
+    "rjmp": 2, "jmp": 3, "ijmp": 2, "rcall": 2, "call": 3, "icall": 2,
+    "ret": 4, "reti": 4, "spm": 4,
+}
+BRANCHES = {"brbs", "brbc", "breq", "brne", "brcs", "brcc", "brsh", "brlo",
+            "brmi", "brpl", "brge", "brlt", "brhs", "brhc", "brts", "brtc",
+            "brvs", "brvc", "brie", "brid"}
+SKIPS = {"cpse", "sbrc", "sbrs", "sbic", "sbis"}
+
+LABEL_RE = re.compile(r"^([0-9a-f]+) <([^>]+)>:$")
+INSN_RE = re.compile(r"^\s*([0-9a-f]+):\t([0-9a-f ]+?)\s*\t(\S+)\s*([^;]*)(?:;(.*))?$")
+TARGET_RE = re.compile(r"0x([0-9a-f]+)")
+
+
+class Insn:
+    def __init__(self, addr, size, op, args, comment):
+        self.addr, self.size, self.op = addr, size, op
+        self.args = [a.strip() for a in args.split(",")] if args.strip() else []
+        self.comment = comment or ""
+
+    def target(self):
+        m = TARGET_RE.search(self.comment) if self.op[0] in "rb" else None
+        if not m and self.args:
+            m = TARGET_RE.search(self.args[-1])
+        return int(m.group(1), 16) if m else None
+
+
+class Function:
+    def __init__(self, name, addr):
+        self.name, self.addr = name, addr
+        self.insns = []
+
+
+class AnalysisError(Exception):
+    pass
+
+
+def parse(lines):
+    funcs = []
+    for line in lines:
+        line = line.rstrip("\n")
+        m = LABEL_RE.match(line)
+        if m:
+            if not m.group(2).startswith(".") or not funcs:
+                funcs.append(Function(m.group(2), int(m.group(1), 16)))
+            continue
+        m = INSN_RE.match(line)
+        if m and funcs:
+            size = len(m.group(2).split())
+            funcs[-1].insns.append(Insn(int(m.group(1), 16), size, m.group(3), m.group(4), m.group(5)))
+    return {f.name: f for f in funcs if f.insns}
+
+
+class Analyser:
+    def __init__(self, funcs, loops):
+        self.funcs = funcs
+        self.by_addr = {f.addr: f for f in funcs.values()}
+        self.loops = dict(LIBGCC_LOOPS)
+        self.loops.update(loops)
+        self.cycles_memo, self.stack_memo = {}, {}
+        self.active = set()
+        self.deepest = None
+
+    def callee(self, insn):
+        if insn.op == "rcall" and insn.args == [".+0"]:
+            return None
+        t = insn.target()
+        return self.by_addr.get(t)
+
+    # Successors of instruction i as (index or None for exit, extra cycles, tail callee)
+    def edges(self, f, i):
+        insn, insns = f.insns[i], f.insns
+        op = insn.op
+        nxt = i + 1 if i + 1 < len(insns) else None
+        if op in ("ret", "reti"):
+            return [(None, 0, None)]
+        if op in ("rjmp", "jmp"):
+            t = insn.target()
+            for k, other in enumerate(insns):
+                if other.addr == t:
+                    return [(k, 0, None)]
+            tail = self.by_addr.get(t)
+            if tail is None:
+                raise AnalysisError("%s: jump to unknown 0x%x" % (f.name, t or 0))
+            return [(None, 0, tail)]
+        if op == "ijmp":
+            raise AnalysisError("%s: indirect jump at 0x%x" % (f.name, insn.addr))
+        if op in BRANCHES:
+            t = insn.target()
+            k = next((k for k, other in enumerate(insns) if other.addr == t), None)
+            if k is None:
+                raise AnalysisError("%s: branch out of function at 0x%x" % (f.name, insn.addr))
+            return [(nxt, 0, None), (k, 1, None)]
+        if op in SKIPS:
+            if nxt is None:
+                raise AnalysisError("%s: skip at the end at 0x%x" % (f.name, insn.addr))
+            skip = i + 2 if i + 2 < len(insns) else None
+            return [(nxt, 0, None), (skip, insns[i + 1].size // 2, None)]
+        if nxt is None:
+            raise AnalysisError("%s: falls off the end at 0x%x" % (f.name, insn.addr))
+        return [(nxt, 0, None)]
+
+    def insn_cycles(self, insn):
+        c = CYCLES.get(insn.op, 1)
+        if insn.op in ("call", "rcall"):
+            callee = self.callee(insn)
+            if callee is not None:
+                c += self.cycles(callee)
+        elif insn.op == "icall":
+            raise AnalysisError("indirect call at 0x%x" % insn.addr)
+        return c
+
+    def cycles(self, f):
+        if f.name in self.cycles_memo:
+            return self.cycles_memo[f.name]
+        if f.name in self.active:
+            raise AnalysisError("%s: recursion" % f.name)
+        self.active.add(f.name)
+        try:
+            self.cycles_memo[f.name] = self.longest_path(f)
+        finally:
+            self.active.discard(f.name)
+        return self.cycles_memo[f.name]
+
+    def longest_path(self, f):
+        n = len(f.insns)
+        succ = [self.edges(f, i) for i in range(n)]
+        cost = [self.insn_cycles(insn) for insn in f.insns]
+
+        # Strongly connected components (Tarjan, iterative); a component with
+        # more than one instruction, or a self edge, is a loop
+        index, low, comp, stack, on = {}, {}, [None] * n, [], set()
+        counter, ncomp = 0, 0
+        for root in range(n):
+            if root in index:
+                continue
+            work = [(root, 0)]
+            while work:
+                v, e = work.pop()
+                if e == 0:
+                    index[v] = low[v] = counter
+                    counter += 1
+                    stack.append(v)
+                    on.add(v)
+                targets = [s for s, _, _ in succ[v] if s is not None]
+                if e < len(targets):
+                    work.append((v, e + 1))
+                    w = targets[e]
+                    if w not in index:
+                        work.append((w, 0))
+                    elif w in on:
+                        low[v] = min(low[v], index[w])
+                    continue
+                if low[v] == index[v]:
+                    while True:
+                        w = stack.pop()
+                        on.discard(w)
+                        comp[w] = ncomp
+                        if w == v:
+                            break
+                    ncomp += 1
+                if work:
+                    u = work[-1][0]
+                    low[u] = min(low[u], low[v])
+
+        members = [[] for _ in range(ncomp)]
+        for v in range(n):
+            members[comp[v]].append(v)
+        weight = [0] * ncomp
+        for c, vs in enumerate(members):
+            looped = len(vs) > 1 or any(s == vs[0] for s, _, _ in succ[vs[0]])
+            if looped:
+                if f.name not in self.loops:
+                    raise AnalysisError("%s: loop at 0x%x needs --loop %s=N"
+                                        % (f.name, f.insns[min(vs)].addr, f.name))
+                body = sum(cost[v] + max(x for _, x, _ in succ[v]) for v in vs)
+                weight[c] = self.loops[f.name] * body
+            else:
+                weight[c] = cost[vs[0]]
+
+        # Tarjan numbers components in reverse topological order
+        best = [0] * ncomp
+        for c in range(ncomp):
+            out = 0
+            for v in members[c]:
+                for s, extra, tail in succ[v]:
+                    if s is None:
+                        out = max(out, extra + (self.cycles(tail) if tail else 0))
+                    elif comp[s] != c:
+                        out = max(out, extra + best[comp[s]])
+                    else:
+                        out = max(out, extra)
+            best[c] = weight[c] + out
+        return best[comp[0]]
+
+    def stack(self, f):
+        if f.name in self.stack_memo:
+            return self.stack_memo[f.name]
+        if f.name in self.active:
+            raise AnalysisError("%s: recursion" % f.name)
+        self.active.add(f.name)
+        try:
+            self.stack_memo[f.name] = self.deepest_point(f)
+        finally:
+            self.active.discard(f.name)
+        return self.stack_memo[f.name]
+
+    def deepest_point(self, f):
+        depth = {0: (0, 0)}             # index -> (bytes pushed, pending SP adjust)
+        work, worst = [0], 0
+        while work:
+            i = work.pop()
+            d, pend = depth[i]
+            insn = f.insns[i]
+            op, a = insn.op, insn.args
+            reach = d
+            if op == "push":
+                d += 1
+            elif op == "pop":
+                d -= 1
+            elif op == "rcall" and a == [".+0"]:
+                d += 2
+            elif op in ("call", "rcall"):
+                callee = self.callee(insn)
+                reach = d + CALL_STACK + (self.stack(callee) if callee else 0)
+            elif op == "icall":
+                reach = d + CALL_STACK + self.max_stack(exclude=f.name)
+            elif op == "sbiw" and a[0] == "r28":
+                pend = int(a[1], 0)
+            elif op == "adiw" and a[0] == "r28":
+                pend = -int(a[1], 0)
+            elif op == "subi" and a[0] == "r28":
+                pend = int(a[1], 0)             # low byte, sbci r29 follows
+            elif op == "sbci" and a[0] == "r29":
+                v = (int(a[1], 0) << 8) | (pend & 0xFF)
+                pend = v if v < 0x8000 else v - 0x10000
+            elif op == "out" and a[0] in ("0x3d", "0x3e") and pend:
+                d += pend
+                pend = 0
+            worst = max(worst, reach, d)
+            if d > 0x400:
+                raise AnalysisError("%s: stack grows in a loop at 0x%x" % (f.name, insn.addr))
+            for s, _, tail in self.edges(f, i):
+                if tail is not None:
+                    worst = max(worst, d + self.stack(tail))
+                if s is not None and (s not in depth or depth[s][0] < d):
+                    depth[s] = (d, pend)
+                    work.append(s)
+        return worst
+
+    def max_stack(self, exclude):
+        if self.deepest is None:
+            self.deepest = 0
+            for f in self.funcs.values():
+                if f.name == exclude or f.name in self.active:
+                    continue
+                try:
+                    self.deepest = max(self.deepest, self.stack(f))
+                except AnalysisError:
+                    pass
+        return self.deepest
+
+
+def isr_name(fname):
+    m = re.match(r"__vector_(\d+)$", fname)
+    return VECTORS.get(int(m.group(1)), fname) if m else None
+
+
+def pairs(items, what):
+    out = {}
+    for item in items or []:
+        name, _, value = item.partition("=")
+        if not value:
+            sys.exit("bad %s '%s', expected NAME=N" % (what, item))
+        out[name.strip()] = int(value, 0)
+    return out
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("elf", nargs="?")
+    ap.add_argument("--listing", help="read avr-objdump -d output instead of an ELF")
+    ap.add_argument("--objdump", default="avr-objdump")
+    ap.add_argument("--budget", action="append", help="ISR=cycles, e.g. TCB0_INT=3333")
+    ap.add_argument("--loop", action="append", help="function=iterations")
+    ap.add_argument("--stack", type=int, help="worst-case total stack budget in bytes")
+    ap.add_argument("--level1", help="the ISR at CPUINT level 1, which nests into the others")
+    ap.add_argument("-v", "--verbose", action="store_true", help="also list every function")
+    args = ap.parse_args()
+
+    if args.listing:
+        with open(args.listing) as f:
+            lines = f.readlines()
+    elif args.elf:
+        out = subprocess.run([args.objdump, "-d", args.elf], capture_output=True, text=True, check=True)
+        lines = out.stdout.splitlines()
+    else:
+        ap.error("need an ELF or --listing")
+
+    funcs = parse(lines)
+    budgets = pairs(args.budget, "budget")
+    an = Analyser(funcs, pairs(args.loop, "loop"))
+    failed = False
+
+    # Worst case of every ISR in the image: name -> (cycles or None, stack or None)
+    isrs = {}
+    for fname in sorted(funcs, key=lambda n: funcs[n].addr):
+        name = isr_name(fname)
+        if name is None:
+            continue
+        try:
+            stk = IRQ_ENTRY_STACK + an.stack(funcs[fname])
+        except AnalysisError as e:
+            print("%-14s stack unbounded: %s" % (name, e))
+            stk = None
+        try:
+            cyc = IRQ_ENTRY_CYCLES + an.cycles(funcs[fname])
+        except AnalysisError as e:
+            print("%-14s cycles unbounded: %s" % (name, e))
+            cyc = None
+        isrs[name] = (cyc, stk)
+
+    level1 = args.level1
+    if level1 and level1 not in isrs:
+        print("%-14s level 1 ISR not in image" % level1)
+        level1 = None
+    nest_cyc, nest_stk = isrs[level1] if level1 else (0, 0)
+
+    print("%-14s %8s %8s %8s %6s" % ("ISR", "cycles", "nested", "budget", "stack"))
+    stack_known = True
+    isr_stack = 0
+    for name, (cyc, stk) in isrs.items():
+        budget = budgets.get(name)
+        if stk is None:
+            stack_known = False
+        elif name != level1:
+            isr_stack = max(isr_stack, stk)
+        if cyc is None:
+            failed |= budget is not None
+            continue
+        # Only the level 1 vector can cut in, and not into itself
+        if name == level1:
+            nested = cyc
+        elif nest_cyc is None:
+            print("%-14s nested cycles unbounded: %s is" % (name, level1))
+            failed |= budget is not None
+            continue
+        else:
+            nested = cyc + nest_cyc
+        over = budget is not None and nested > budget
+        failed |= over
+        print("%-14s %8d %8d %8s %6s%s" % (name, cyc, nested, budget if budget else "-",
+                                           stk if stk is not None else "-",
+                                           "  OVER BUDGET" if over else ""))
+    for name in sorted(set(budgets) - set(isrs)):
+        print("%-14s not in image" % name)
+
+    try:
+        main_stack = an.stack(funcs["main"]) + CALL_STACK if "main" in funcs else 0
+    except AnalysisError as e:
+        print("main           stack unbounded: %s" % e)
+        stack_known = False
+        main_stack = 0
+    if stack_known:
+        total = main_stack + isr_stack + (nest_stk if level1 else 0)
+        if level1:
+            parts = "main %d + deepest level 0 ISR %d + %s %d" % (main_stack, isr_stack, level1, nest_stk)
+        else:
+            parts = "main %d + deepest ISR %d" % (main_stack, isr_stack)
+        print("stack: %s = %d bytes%s" % (
+            parts, total,
+            " (budget %d)%s" % (args.stack, "  OVER BUDGET" if total > args.stack else "") if args.stack else ""))
+        failed |= args.stack is not None and total > args.stack
+    else:
+        failed |= args.stack is not None
+
+    if args.verbose:
+        print()
+        print("%-28s %8s %6s" % ("function", "cycles", "stack"))
+        for fname in sorted(funcs, key=lambda n: funcs[n].addr):
+            try:
+                cyc = "%d" % an.cycles(funcs[fname])
+            except AnalysisError:
+                cyc = "-"
+            try:
+                stk = "%d" % an.stack(funcs[fname])
+            except AnalysisError:
+                stk = "-"
+            print("%-28s %8s %6s" % (fname, cyc, stk))
+
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,48 @@
+# PlatformIO extra script: runs tools/isr_budget.py on every firmware.elf
+# and fails the build when an ISR or the stack is over budget. The budgets
+# come from the custom_isr_* options of the environment in platformio.ini.
+# `pio run -t isr_report` prints the per-function table as well.
+Import("env")
+
+import os
+import sys
+
+TOOL = os.path.join(env.subst("$PROJECT_DIR"), "tools", "isr_budget.py")
+ELF = "$BUILD_DIR/${PROGNAME}.elf"
+
+
+def option_lines(name):
+    value = env.GetProjectOption(name, "")
+    return [line.split(";")[0].split() for line in value.splitlines() if line.split(";")[0].strip()]
+
+
+def define_value(name):
+    for d in env.get("CPPDEFINES", []):
+        if isinstance(d, (list, tuple)) and d[0] == name:
+            return str(d[1])
+        if d == name:
+            return "1"
+    return None
+
+
+def command(verbose):
+    objdump = env.subst("$OBJCOPY").replace("objcopy", "objdump")
+    cmd = ['"%s"' % sys.executable, '"%s"' % TOOL, '"%s"' % ELF, "--objdump", '"%s"' % objdump]
+    for name, cycles in option_lines("custom_isr_budget"):
+        cmd += ["--budget", "%s=%s" % (name, cycles)]
+    for name, bound in option_lines("custom_isr_loops"):
+        cmd += ["--loop", "%s=%s" % (name, bound)]
+    level1 = env.GetProjectOption("custom_isr_level1", "")
+    if level1 and define_value("IRQ_PRIORITY") != "0":     # include/irq.h
+        cmd += ["--level1", level1]
+    stack = env.GetProjectOption("custom_stack_budget", "")
+    if stack:
+        cmd += ["--stack", stack]
+    if verbose:
+        cmd.append("-v")
+    return " ".join(cmd)
+
+
+env.AddPostAction(ELF, env.VerboseAction(command(False), "Checking ISR budgets"))
+env.AddCustomTarget("isr_report", ELF, command(True), title="ISR report",
+                    description="Worst-case ISR cycles and stack per function")
@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+"""Decode the firmware's COBS-framed telemetry stream into CSV.
+
+Usage:
+    telemetry_decode.py capture.bin > events.csv
+    telemetry_decode.py --port /dev/ttyUSB0 > events.csv   (needs pyserial)
+
+A record of n bytes COBS-encodes to exactly n + 1, so each frame is
+decoded from the last n + 1 bytes before its 0x00, for every record
+length the firmware sends. That skips text output interleaved on the same
+UART (e.g. "SUCCESS\n"). A record counts only if its length and type byte
+agree and its CRC matches. tlog.h records (type 0x80 + number of args,
+read with tlog_decode.py) are skipped silently; anything else is counted
+as an invalid frame.
+The 16-bit timestamps are unwrapped into a monotonically increasing t_ms.
+"""
+import argparse
+import csv
+import struct
+import sys
+
+EVENTS = {1: "step", 2: "input", 3: "success", 4: "fail", 5: "octave", 6: "delay"}
+SOURCES = {0: "pushbutton", 1: "uart"}
+RECORD_LEN = 6
+TLOG_TYPE = 0x80
+TLOG_MAX_ARGS = 2
+
+
+def crc8(data):
+    crc = 0
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+def cobs_decode(frame):
+    out = bytearray()
+    i = 0
+    while i < len(frame):
+        code = frame[i]
+        if code == 0 or i + code > len(frame):
+            return None
+        out += frame[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(frame):
+            out.append(0)
+    return bytes(out)
+
+
+def frames(stream):
+    buf = bytearray()
+    while True:
+        chunk = stream.read(256)
+        if not chunk:
+            return
+        for b in chunk:
+            if b == 0:
+                yield bytes(buf)
+                buf.clear()
+            else:
+                buf.append(b)
+
+
+def record_type_ok(rec):
+    if rec[0] >= TLOG_TYPE:
+        return rec[0] - TLOG_TYPE <= TLOG_MAX_ARGS and len(rec) == RECORD_LEN + 2 * (rec[0] - TLOG_TYPE)
+    return rec[0] in EVENTS and len(rec) == RECORD_LEN
+
+
+def parse(frame):
+    """The record ending this frame, longest candidate first, else None"""
+    for nargs in range(TLOG_MAX_ARGS, -1, -1):
+        rec_len = RECORD_LEN + 2 * nargs
+        rec = cobs_decode(frame[-(rec_len + 1):])
+        if rec is not None and len(rec) == rec_len and crc8(rec[:-1]) == rec[-1] and record_type_ok(rec):
+            return rec
+    return None
+
+
+def decode(stream, out):
+    writer = csv.writer(out)
+    writer.writerow(["t_ms", "event", "source", "value"])
+    last_t = None
+    base = 0
+    bad = 0
+    for frame in frames(stream):
+        rec = parse(frame)
+        if rec is None:
+            bad += 1
+            continue
+        if rec[0] >= TLOG_TYPE:
+            continue            # include/tlog.h records, see tlog_decode.py
+        etype, value, t = struct.unpack("<BHH", rec[:-1])
+        if last_t is not None and t < last_t:
+            base += 0x10000
+        last_t = t
+
+        source = ""
+        if etype == 2:
+            source = SOURCES.get(value >> 8, str(value >> 8))
+            value &= 0xFF
+        elif etype == 5:
+            value = value - 256 if value & 0x80 else value
+        writer.writerow([base + t, EVENTS.get(etype, str(etype)), source, value])
+    if bad:
+        print(f"{bad} invalid frame(s) skipped", file=sys.stderr)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("capture", nargs="?", help="raw capture file (default stdin)")
+    ap.add_argument("--port", help="read live from a serial port instead")
+    ap.add_argument("--baud", type=int, default=9600)
+    args = ap.parse_args()
+
+    if args.port:
+        import serial
+        stream = serial.Serial(args.port, args.baud)
+    elif args.capture:
+        stream = open(args.capture, "rb")
+    else:
+        stream = sys.stdin.buffer
+    try:
+        decode(stream, sys.stdout)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
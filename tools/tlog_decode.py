@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+"""Print the firmware's tokenized log (include/tlog.h) as text.
+
+Usage:
+    tlog_decode.py firmware.elf capture.bin
+    tlog_decode.py firmware.elf --port /dev/ttyUSB0        (needs pyserial)
+
+The format strings are read from the .tlog section of the ELF that made
+the capture (.pio/build/QUTy/firmware.elf, or the native program, which
+keeps them in "tlog"); a record's token is the string's offset in that
+section. Records share the telemetry framing, so telemetry events and
+text on the same UART are skipped. Each line is "t_ms text", with the
+16-bit timestamps unwrapped.
+"""
+import argparse
+import re
+import struct
+import sys
+
+from telemetry_decode import cobs_decode, crc8, frames
+
+TLOG_TYPE = 0x80
+MAX_ARGS = 2
+CONVERSION = re.compile(r"%([-+ 0#]*\d*(?:\.\d+)?)[hlL]*([diouxXc%])")
+
+
+def read_section(path, names=(".tlog", "tlog")):
+    """Contents of the first section called one of `names`, from a 32 or 64-bit ELF."""
+    with open(path, "rb") as f:
+        elf = f.read()
+    if elf[:4] != b"\x7fELF":
+        raise ValueError(f"{path}: not an ELF file")
+    is64 = elf[4] == 2
+    order = "<" if elf[5] == 1 else ">"
+    if is64:
+        shoff, = struct.unpack_from(order + "Q", elf, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from(order + "HHH", elf, 0x3A)
+        fmt = order + "IIQQQQ"          # name, type, flags, addr, offset, size
+    else:
+        shoff, = struct.unpack_from(order + "I", elf, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from(order + "HHH", elf, 0x2E)
+        fmt = order + "IIIIII"
+
+    def header(k):
+        fields = struct.unpack_from(fmt, elf, shoff + k * shentsize)
+        return fields[0], fields[4], fields[5]
+
+    _, str_off, _ = header(shstrndx)
+    for k in range(shnum):
+        name_off, off, size = header(k)
+        end = elf.index(b"\0", str_off + name_off)
+        if elf[str_off + name_off:end].decode() in names:
+            return elf[off:off + size]
+    raise ValueError(f"{path}: no .tlog section (built without -DTLOG=1?)")
+
+
+def render(fmt, args):
+    """printf-style formatting of 16-bit arguments"""
+    values = iter(args)
+
+    def one(m):
+        flags, conv = m.groups()
+        if conv == "%":
+            return "%"
+        v = next(values, 0)
+        if conv in "di" and v & 0x8000:
+            v -= 0x10000
+        if conv == "c":
+            return chr(v & 0xFF)
+        return ("%" + flags + ("d" if conv in "diu" else conv)) % v
+
+    return CONVERSION.sub(one, fmt)
+
+
+def parse(frame):
+    """(token, t, args) of the log record ending this frame, else None"""
+    for nargs in range(MAX_ARGS, -1, -1):
+        rec_len = 6 + 2 * nargs
+        rec = cobs_decode(frame[-(rec_len + 1):])
+        if rec is None or len(rec) != rec_len or rec[0] != TLOG_TYPE + nargs or crc8(rec[:-1]) != rec[-1]:
+            continue
+        token, t = struct.unpack_from("<HH", rec, 1)
+        args = struct.unpack_from("<%dH" % nargs, rec, 5)
+        return token, t, args
+    return None
+
+
+def decode(strings, stream, out):
+    last_t = None
+    base = 0
+    for frame in frames(stream):
+        rec = parse(frame)
+        if rec is None:
+            continue
+        token, t, args = rec
+        if last_t is not None and t < last_t:
+            base += 0x10000
+        last_t = t
+
+        end = strings.find(b"\0", token)
+        if token >= len(strings) or end < 0:
+            text = f"<unknown token {token:#06x}> " + " ".join(str(a) for a in args)
+        else:
+            text = render(strings[token:end].decode(errors="replace"), args)
+        print(f"{base + t} {text}", file=out)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("elf", help="firmware ELF with the .tlog section")
+    ap.add_argument("capture", nargs="?", help="raw capture file (default stdin)")
+    ap.add_argument("--port", help="read live from a serial port instead")
+    ap.add_argument("--baud", type=int, default=9600)
+    args = ap.parse_args()
+
+    try:
+        strings = read_section(args.elf)
+    except (OSError, ValueError) as e:
+        sys.exit(str(e))
+
+    if args.port:
+        import serial
+        stream = serial.Serial(args.port, args.baud)
+    elif args.capture:
+        stream = open(args.capture, "rb")
+    else:
+        stream = sys.stdin.buffer
+    try:
+        decode(strings, stream, sys.stdout)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
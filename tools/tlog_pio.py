@@ -0,0 +1,8 @@
+# PlatformIO extra script: links tools/tlog.ld so TLOG format strings stay
+# out of flash (see include/tlog.h). Harmless when TLOG is off, as the
+# .tlog section is then empty and dropped.
+Import("env")
+
+import os
+
+env.Append(LINKFLAGS=["-Wl,-T," + os.path.join(env.subst("$PROJECT_DIR"), "tools", "tlog.ld")])